@@ -0,0 +1,544 @@
+// Throughput benchmark for cj_parse_n, cj_stringify and cj_clean over
+// generated corpora.
+//
+//   bench [-n runs] [-s megabytes] [-j threads] [-p] [-t] [corpus...]
+//
+// Each operation is timed on its own and the best of `runs` is reported,
+// with the number of system allocator calls it made. -p goes through the
+// *_with calls with cj_pool_allocator instead. With -j every thread works
+// on a tree of its own at the same time, and MB/s is the total over all of
+// them. MB/s is relative to the input text, except for stringify where it
+// is relative to the output. With -t every measurement is one tab-separated
+// line, for diffing the results of two builds.
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Per thread, so that counting adds no sharing of its own between threads.
+static _Thread_local uint64_t allocs;
+static _Thread_local uint64_t frees;
+
+static void *bench_malloc(size_t size) {
+  ++allocs;
+  return malloc(size);
+}
+
+static void *bench_realloc(void *ptr, size_t size) {
+  ++allocs;
+  return realloc(ptr, size);
+}
+
+static void bench_free(void *ptr) {
+  frees += ptr != NULL;
+  free(ptr);
+}
+
+#define cj_malloc(size) bench_malloc(size)
+#define cj_realloc(ptr, size) bench_realloc(ptr, size)
+#define cj_free(ptr) bench_free(ptr)
+
+// Built into the benchmark so that its allocations can be counted.
+#include "cjson.c"
+
+typedef struct text text;
+
+struct text {
+  char *data;
+  uint64_t len;
+  uint64_t cap;
+};
+
+static void text_reserve(text *t, uint64_t len) {
+  if (t->len + len + 1 > t->cap) {
+    while (t->len + len + 1 > t->cap) {
+      t->cap = t->cap == 0 ? 1 << 16 : t->cap << 1;
+    }
+    t->data = realloc(t->data, t->cap);
+  }
+}
+
+static void text_put(text *t, const char *s) {
+  uint64_t len = strlen(s);
+  text_reserve(t, len);
+  memcpy(t->data + t->len, s, len + 1);
+  t->len += len;
+}
+
+static void text_printf(text *t, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  text_reserve(t, len);
+  va_start(args, format);
+  vsnprintf(t->data + t->len, len + 1, format, args);
+  va_end(args);
+  t->len += len;
+}
+
+// Replaces the trailing ',' of a finished list with the closing bracket.
+static void text_close(text *t, char bracket) {
+  if (t->data[t->len - 1] == ',') {
+    --t->len;
+  }
+  text_reserve(t, 1);
+  t->data[t->len++] = bracket;
+  t->data[t->len] = '\0';
+}
+
+static uint64_t rnd_state;
+
+static uint64_t rnd(void) {
+  rnd_state ^= rnd_state << 13;
+  rnd_state ^= rnd_state >> 7;
+  rnd_state ^= rnd_state << 17;
+  return rnd_state;
+}
+
+static uint64_t rnd_below(uint64_t n) {
+  return rnd() % n;
+}
+
+static const char *words[] = {
+  "lorem", "ipsum", "dolor", "sit", "amet", "json", "parser", "benchmark",
+  "\\\"quoted\\\"", "tab\\t", "line\\n", "path\\/to", "\\u00e9t\\u00e9",
+  "caf\xc3\xa9", "\xe4\xb8\xad\xe6\x96\x87", "\xf0\x9f\x9a\x80",
+};
+
+static void put_sentence(text *t, int count) {
+  text_put(t, "\"");
+  for (int i = 0; i < count; ++i) {
+    text_put(t, i == 0 ? "" : " ");
+    text_put(t, words[rnd_below(sizeof(words) / sizeof(words[0]))]);
+  }
+  text_put(t, "\"");
+}
+
+static void generate_strings(text *t, uint64_t size) {
+  text_put(t, "[");
+  while (t->len < size) {
+    put_sentence(t, 1 + (int)rnd_below(30));
+    text_put(t, ",");
+  }
+  text_close(t, ']');
+}
+
+static void put_number(text *t) {
+  switch (rnd_below(4)) {
+  case 0:
+    text_printf(t, "%lld", (long long)rnd_below(2000000000) - 1000000000);
+    break;
+  case 1:
+    text_printf(t, "%d", (int)rnd_below(100));
+    break;
+  case 2:
+    text_printf(t, "%.*f", 1 + (int)rnd_below(6), (double)rnd_below(1000000) / 1000);
+    break;
+  default:
+    text_printf(t, "%.17g", ldexp((double)(rnd() >> 11), (int)rnd_below(200) - 150));
+    break;
+  }
+}
+
+static void generate_numbers(text *t, uint64_t size) {
+  text_put(t, "[");
+  while (t->len < size) {
+    text_put(t, "[");
+    for (int i = 0; i < 8; ++i) {
+      put_number(t);
+      text_put(t, ",");
+    }
+    text_close(t, ']');
+    text_put(t, ",");
+  }
+  text_close(t, ']');
+}
+
+// Chains of objects and arrays up to 500 deep around a small value.
+static void generate_nested(text *t, uint64_t size) {
+  char closing[500];
+  text_put(t, "[");
+  while (t->len < size) {
+    int depth = 1 + (int)rnd_below(sizeof(closing));
+    for (int i = 0; i < depth; ++i) {
+      closing[i] = rnd_below(2) ? '}' : ']';
+      text_put(t, closing[i] == '}' ? "{\"k\":" : "[");
+    }
+    put_number(t);
+    for (int i = depth - 1; i >= 0; --i) {
+      text_close(t, closing[i]);
+    }
+    text_put(t, ",");
+  }
+  text_close(t, ']');
+}
+
+static void generate_wide(text *t, uint64_t size) {
+  text_put(t, "[");
+  while (t->len < size) {
+    text_put(t, "{");
+    for (int i = 0; i < 2000; ++i) {
+      text_printf(t, "\"field_%d\":", i);
+      if (rnd_below(2)) {
+        put_number(t);
+      } else {
+        put_sentence(t, 1);
+      }
+      text_put(t, ",");
+    }
+    text_close(t, '}');
+    text_put(t, ",");
+  }
+  text_close(t, ']');
+}
+
+// Records shaped like the statuses of a social network API.
+static void generate_twitter(text *t, uint64_t size) {
+  text_put(t, "[");
+  while (t->len < size) {
+    uint64_t id = 1000000000000000000ULL + rnd_below(1000000000000000000ULL);
+    text_printf(t, "{\"id\":%llu,\"id_str\":\"%llu\",\"text\":", (unsigned long long)id, (unsigned long long)id);
+    put_sentence(t, 5 + (int)rnd_below(20));
+    text_printf(t, ",\"user\":{\"id\":%d,\"name\":", (int)rnd_below(1000000000));
+    put_sentence(t, 2);
+    text_put(t, ",\"screen_name\":");
+    put_sentence(t, 1);
+    text_printf(t, ",\"followers_count\":%d,\"friends_count\":%d,\"verified\":%s,",
+      (int)rnd_below(1000000), (int)rnd_below(5000), rnd_below(10) == 0 ? "true" : "false");
+    text_put(t, "\"profile\":{\"background_color\":\"C0DEED\",\"link_color\":\"1DA1F2\",\"use_background_image\":true}},");
+    text_put(t, "\"entities\":{\"hashtags\":[");
+    for (int i = (int)rnd_below(4); i > 0; --i) {
+      int start = (int)rnd_below(100);
+      text_put(t, "{\"text\":");
+      put_sentence(t, 1);
+      text_printf(t, ",\"indices\":[%d,%d]},", start, start + 1 + (int)rnd_below(20));
+    }
+    text_close(t, ']');
+    text_put(t, ",\"urls\":[],\"user_mentions\":[]},");
+    text_printf(t, "\"retweet_count\":%d,\"favorite_count\":%d,\"favorited\":false,\"retweeted\":false,",
+      (int)rnd_below(10000), (int)rnd_below(10000));
+    text_printf(t, "\"geo\":null,\"coordinates\":%s,\"lang\":\"en\"},",
+      rnd_below(8) == 0 ? "[-122.4194,37.7749]" : "null");
+  }
+  text_close(t, ']');
+}
+
+// Re-indents minified text by two spaces per level, one value per line.
+static void prettify(const text *in, text *out) {
+  int depth = 0;
+  bool in_string = false;
+  for (uint64_t i = 0; i < in->len; ++i) {
+    char c = in->data[i];
+    text_reserve(out, 2 * depth + 4);
+    char *p = out->data + out->len;
+    if (in_string) {
+      *p++ = c;
+      if (c == '\\') {
+        *p++ = in->data[++i];
+      } else if (c == '"') {
+        in_string = false;
+      }
+    } else if ((c == '{' || c == '[') && in->data[i + 1] != (c == '{' ? '}' : ']')) {
+      *p++ = c;
+      *p++ = '\n';
+      ++depth;
+      memset(p, ' ', 2 * depth);
+      p += 2 * depth;
+    } else if ((c == '}' || c == ']') && in->data[i - 1] != (c == '}' ? '{' : '[')) {
+      *p++ = '\n';
+      --depth;
+      memset(p, ' ', 2 * depth);
+      p += 2 * depth;
+      *p++ = c;
+    } else if (c == ',') {
+      *p++ = c;
+      *p++ = '\n';
+      memset(p, ' ', 2 * depth);
+      p += 2 * depth;
+    } else if (c == ':') {
+      *p++ = c;
+      *p++ = ' ';
+    } else {
+      in_string = c == '"';
+      *p++ = c;
+    }
+    out->len = p - out->data;
+  }
+  text_reserve(out, 1);
+  out->data[out->len++] = '\n';
+  out->data[out->len] = '\0';
+}
+
+typedef struct corpus corpus;
+
+struct corpus {
+  const char *name;
+  void (*generate)(text *t, uint64_t size);
+  bool pretty;
+};
+
+static const corpus corpora[] = {
+  {"strings", generate_strings, false},
+  {"numbers", generate_numbers, false},
+  {"nested", generate_nested, false},
+  {"wide", generate_wide, false},
+  {"twitter", generate_twitter, false},
+  {"twitter-pretty", generate_twitter, true},
+};
+
+static uint64_t count_nodes(const cj_value *value) {
+  uint64_t count = 1;
+  if (value->type == CJ_TYPE_OBJECT || value->type == CJ_TYPE_ARRAY) {
+    const cj_value *p = value->value.members;
+    for (; p != NULL; p = p->next) {
+      count += count_nodes(p);
+    }
+  }
+  return count;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+typedef struct measure measure;
+
+// Best time of all runs of one operation, and the allocator calls it made.
+struct measure {
+  uint64_t ns;
+  uint64_t allocs;
+  uint64_t frees;
+};
+
+static void report(const char *corpus_name, const char *op, uint64_t bytes, uint64_t nodes, const measure *m, bool tsv) {
+  double seconds = m->ns > 0 ? m->ns / 1e9 : 1e-9;
+  double mbps = bytes / seconds / 1e6;
+  double ns_per_node = (double)m->ns / nodes;
+  if (tsv) {
+    printf("%s\t%s\t%llu\t%llu\t%llu\t%.1f\t%.2f\t%llu\t%llu\n", corpus_name, op,
+      (unsigned long long)bytes, (unsigned long long)nodes, (unsigned long long)m->ns,
+      mbps, ns_per_node, (unsigned long long)m->allocs, (unsigned long long)m->frees);
+  } else {
+    printf("%-16s %-10s %10.1f %10.2f %10llu %10llu\n", corpus_name, op, mbps, ns_per_node,
+      (unsigned long long)m->allocs, (unsigned long long)m->frees);
+  }
+}
+
+#define OP_PARSE     0
+#define OP_STRINGIFY 1
+#define OP_CLEAN     2
+#define OP_COUNT     3
+
+typedef struct job job;
+
+// One corpus run by `threads` workers in lockstep: every operation starts
+// together after a barrier and is timed by worker 0 until the last one is
+// done.
+struct job {
+  const text *t;
+  const cj_allocator *allocator;
+  int runs;
+  int threads;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int waiting;
+  uint64_t round;
+  measure measures[OP_COUNT];
+  uint64_t allocs[OP_COUNT];
+  uint64_t frees[OP_COUNT];
+  uint64_t nodes;
+  uint64_t out_len;
+  bool failed;
+};
+
+typedef struct worker worker;
+
+struct worker {
+  job *job;
+  int id;
+};
+
+// Waits for every worker; the counts of the operation just done are added
+// up on the way in.
+static void job_barrier(job *j, int op) {
+  pthread_mutex_lock(&j->lock);
+  if (op >= 0) {
+    j->allocs[op] += allocs;
+    j->frees[op] += frees;
+  }
+  uint64_t round = j->round;
+  if (++j->waiting == j->threads) {
+    j->waiting = 0;
+    ++j->round;
+    pthread_cond_broadcast(&j->cond);
+  } else {
+    while (round == j->round) {
+      pthread_cond_wait(&j->cond, &j->lock);
+    }
+  }
+  pthread_mutex_unlock(&j->lock);
+}
+
+static void job_start(job *j, uint64_t *start) {
+  job_barrier(j, -1);
+  allocs = 0;
+  frees = 0;
+  *start = now_ns();
+}
+
+static void job_stop(job *j, int op, uint64_t start, bool timer) {
+  job_barrier(j, op);
+  if (timer) {
+    measure *m = &j->measures[op];
+    uint64_t ns = now_ns() - start;
+    if (m->ns == 0 || ns < m->ns) {
+      m->ns = ns;
+    }
+    m->allocs = j->allocs[op];
+    m->frees = j->frees[op];
+    // no one adds to them again before this worker reaches the next start
+    j->allocs[op] = 0;
+    j->frees[op] = 0;
+  }
+}
+
+static void *job_work(void *arg) {
+  worker *w = arg;
+  job *j = w->job;
+  bool timer = w->id == 0;
+  for (int i = 0; i < j->runs; ++i) {
+    uint64_t start;
+    uint64_t out_len;
+    job_start(j, &start);
+    cj_value *value = cj_parse_with(j->t->data, j->t->len, NULL, j->allocator);
+    job_stop(j, OP_PARSE, start, timer);
+    if (value == NULL) {
+      j->failed = true;
+      return NULL;
+    }
+    if (timer) {
+      j->nodes = count_nodes(value);
+    }
+    job_start(j, &start);
+    char *out = cj_stringify_with(value, &out_len, j->allocator);
+    job_stop(j, OP_STRINGIFY, start, timer);
+    allocator_free(j->allocator, out, out_len + 1);
+    if (timer) {
+      j->out_len = out_len;
+    }
+    job_start(j, &start);
+    cj_clean_with(value, j->allocator);
+    job_stop(j, OP_CLEAN, start, timer);
+  }
+  return NULL;
+}
+
+static void run_corpus(const corpus *c, uint64_t size, int runs, int threads, const cj_allocator *allocator, bool tsv) {
+  text t = {NULL, 0, 0};
+  rnd_state = 0x9E3779B97F4A7C15ULL;
+  c->generate(&t, size);
+  if (c->pretty) {
+    text pretty = {NULL, 0, 0};
+    prettify(&t, &pretty);
+    free(t.data);
+    t = pretty;
+  }
+  job j;
+  memset(&j, 0, sizeof(j));
+  j.t = &t;
+  j.allocator = allocator;
+  j.runs = runs;
+  j.threads = threads;
+  pthread_mutex_init(&j.lock, NULL);
+  pthread_cond_init(&j.cond, NULL);
+  worker *workers = malloc(threads * sizeof(worker));
+  pthread_t *ids = malloc(threads * sizeof(pthread_t));
+  for (int i = 0; i < threads; ++i) {
+    workers[i].job = &j;
+    workers[i].id = i;
+    if (i > 0) {
+      pthread_create(&ids[i], NULL, job_work, &workers[i]);
+    }
+  }
+  job_work(&workers[0]);
+  for (int i = 1; i < threads; ++i) {
+    pthread_join(ids[i], NULL);
+  }
+  if (j.failed) { // every worker parses the same text
+    fprintf(stderr, "%s: generated text does not parse\n", c->name);
+    exit(1);
+  }
+  report(c->name, "parse", t.len * threads, j.nodes * threads, &j.measures[OP_PARSE], tsv);
+  report(c->name, "stringify", j.out_len * threads, j.nodes * threads, &j.measures[OP_STRINGIFY], tsv);
+  report(c->name, "clean", t.len * threads, j.nodes * threads, &j.measures[OP_CLEAN], tsv);
+  pthread_mutex_destroy(&j.lock);
+  pthread_cond_destroy(&j.cond);
+  free(workers);
+  free(ids);
+  free(t.data);
+}
+
+static int usage(void) {
+  fprintf(stderr, "usage: bench [-n runs] [-s megabytes] [-j threads] [-p] [-t] [corpus...]\ncorpora:");
+  for (uint64_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); ++i) {
+    fprintf(stderr, " %s", corpora[i].name);
+  }
+  fprintf(stderr, "\n");
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  int runs = 10;
+  int threads = 1;
+  uint64_t size = 8 << 20;
+  const cj_allocator *allocator = NULL;
+  bool tsv = false;
+  bool selected[sizeof(corpora) / sizeof(corpora[0])] = {false};
+  bool any_selected = false;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      runs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      size = (uint64_t)(atof(argv[++i]) * (1 << 20));
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-p") == 0) {
+      allocator = cj_pool_allocator();
+    } else if (strcmp(argv[i], "-t") == 0) {
+      tsv = true;
+    } else {
+      uint64_t j = 0;
+      for (; j < sizeof(corpora) / sizeof(corpora[0]); ++j) {
+        if (strcmp(argv[i], corpora[j].name) == 0) {
+          break;
+        }
+      }
+      if (j == sizeof(corpora) / sizeof(corpora[0])) {
+        return usage();
+      }
+      selected[j] = true;
+      any_selected = true;
+    }
+  }
+  if (runs < 1 || threads < 1 || size == 0) {
+    return usage();
+  }
+  if (tsv) {
+    printf("corpus\top\tbytes\tnodes\tns\tmb_per_s\tns_per_node\tallocs\tfrees\n");
+  } else {
+    printf("%-16s %-10s %10s %10s %10s %10s\n", "corpus", "op", "MB/s", "ns/node", "allocs", "frees");
+  }
+  for (uint64_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); ++i) {
+    if (!any_selected || selected[i]) {
+      run_corpus(&corpora[i], size, runs, threads, allocator, tsv);
+    }
+  }
+  return 0;
+}
@@ -1,35 +1,135 @@
 #include "cjson.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
 #include <stdio.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#define USE_MMAP
+#define USE_WRITEV
+#define USE_THREADS
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define USE_CPU_DISPATCH
+#include <cpuid.h>
+#endif
+
+#if defined(__AVX2__) || defined(USE_CPU_DISPATCH)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 static const char hex_chars[] = "0123456789ABCDEF";
 
+// Everything below allocates through one of these; NULL stands for the
+// cj_malloc family. A NULL pointer is never passed to `realloc` or freed.
+static void *allocator_alloc(const cj_allocator *allocator, uint64_t size) {
+  if (allocator == NULL) {
+    return cj_malloc(size);
+  }
+  return allocator->alloc(allocator->ctx, size);
+}
+
+static void *allocator_realloc(const cj_allocator *allocator, void *ptr, uint64_t old_size, uint64_t size) {
+  if (allocator == NULL) {
+    return cj_realloc(ptr, size);
+  }
+  if (ptr == NULL) {
+    return allocator->alloc(allocator->ctx, size);
+  }
+  return allocator->realloc(allocator->ctx, ptr, old_size, size);
+}
+
+static void allocator_free(const cj_allocator *allocator, void *ptr, uint64_t size) {
+  if (allocator == NULL) {
+    cj_free(ptr);
+  } else if (ptr == NULL) {
+    return;
+  } else if (allocator->free_sized != NULL) {
+    allocator->free_sized(allocator->ctx, ptr, size);
+  } else {
+    allocator->free(allocator->ctx, ptr);
+  }
+}
+
 typedef struct buffer buffer;
 
+// A growable byte buffer. With `writer` set it is a fixed block instead:
+// when full, its contents are passed to the writer and it starts over.
 struct buffer {
   char *data;
   uint64_t cap;
   uint64_t len;
+  cj_writer writer;
+  void *writer_ctx;
+  bool failed;
+  const cj_allocator *allocator;
 };
 
-static void buffer_init(buffer *buf) {
+static void buffer_init(buffer *buf, const cj_allocator *allocator) {
   buf->cap = 64;
-  buf->data = cj_malloc(buf->cap);
+  buf->data = allocator_alloc(allocator, buf->cap);
+  buf->len = 0;
+  buf->writer = NULL;
+  buf->failed = false;
+  buf->allocator = allocator;
+}
+
+static void buffer_init_writer(buffer *buf, char *block, uint64_t cap, cj_writer writer, void *ctx) {
+  buf->cap = cap;
+  buf->data = block;
   buf->len = 0;
+  buf->writer = writer;
+  buf->writer_ctx = ctx;
+  buf->failed = false;
+  buf->allocator = NULL;
 }
 
 static void buffer_clean(buffer *buf) {
-  cj_free(buf->data);
+  allocator_free(buf->allocator, buf->data, buf->cap);
+}
+
+// Doubles the capacity until `len` more bytes fit with room to spare.
+static void buffer_grow(buffer *buf, uint64_t len) {
+  uint64_t cap = buf->cap;
+  do {
+    cap <<= 1;
+  } while(buf->len + len >= cap);
+  buf->data = allocator_realloc(buf->allocator, buf->data, buf->cap, cap);
+  buf->cap = cap;
+}
+
+// Hands the block, followed by `extra` if any, to the writer and empties
+// it. After a failed write the output is dropped.
+static void buffer_flush(buffer *buf, const char *extra, uint64_t extra_len) {
+  cj_chunk chunks[2] = {{buf->data, buf->len}, {extra, extra_len}};
+  const cj_chunk *first = buf->len > 0 ? chunks : chunks + 1;
+  int count = (buf->len > 0) + (extra_len > 0);
+  if (!buf->failed && count > 0 && !buf->writer(buf->writer_ctx, first, count)) {
+    buf->failed = true;
+  }
+  buf->len = 0;
 }
 
 static void buffer_write_byte(buffer *buf, char byte) {
   if (buf->len == buf->cap) {
-    buf->cap <<= 1;
-    buf->data = cj_realloc(buf->data, buf->cap);
+    if (buf->writer != NULL) {
+      buffer_flush(buf, NULL, 0);
+    } else {
+      buffer_grow(buf, 1);
+    }
   }
   buf->data[buf->len] = byte;
   ++buf->len;
@@ -37,101 +137,1394 @@ static void buffer_write_byte(buffer *buf, char byte) {
 
 static void buffer_write_string(buffer *buf, const char *string, uint64_t len) {
   if (buf->len + len >= buf->cap) {
-    do {
-      buf->cap <<= 1;
-    } while(buf->len + len >= buf->cap);
-    buf->data = cj_realloc(buf->data, buf->cap);
+    if (buf->writer != NULL) {
+      if (len >= buf->cap) { // larger than the block: passed along as is
+        buffer_flush(buf, string, len);
+        return;
+      }
+      buffer_flush(buf, NULL, 0);
+    } else {
+      buffer_grow(buf, len);
+    }
   }
-  memcpy(buf->data + buf->len, string, len);
+  memmove(buf->data + buf->len, string, len);
   buf->len += len;
 }
 
-static cj_value *parse_value(const char **pp);
+// Makes room for `len` more bytes and returns where they go; the caller
+// advances buf->len by the amount actually written.
+static char *buffer_reserve(buffer *buf, uint64_t len) {
+  if (buf->len + len >= buf->cap) {
+    if (buf->writer != NULL) {
+      buffer_flush(buf, NULL, 0);
+      return buf->data;
+    }
+    buffer_grow(buf, len);
+  }
+  return buf->data + buf->len;
+}
+
+#define ARENA_ALIGN 8
+#define ARENA_MIN_CHUNK 4096
+#define ARENA_MAX_CHUNK (16 << 20)
+
+typedef struct arena_chunk arena_chunk;
+typedef struct arena arena;
+
+struct arena_chunk {
+  arena_chunk *next;
+  uint64_t cap;
+  uint64_t len;
+  char data[];
+};
+
+struct arena {
+  arena_chunk *head;
+  uint64_t chunk_size;
+  const cj_allocator *allocator;
+};
+
+static void arena_init(arena *a, const cj_allocator *allocator) {
+  a->head = NULL;
+  a->chunk_size = ARENA_MIN_CHUNK;
+  a->allocator = allocator;
+}
+
+static void arena_clean(arena *a) {
+  arena_chunk *next = NULL;
+  arena_chunk *p = a->head;
+  for (; p != NULL; p = next) {
+    next = p->next;
+    allocator_free(a->allocator, p, sizeof(arena_chunk) + p->cap);
+  }
+  a->head = NULL;
+}
+
+// Moves every chunk of `from`, which has the same allocator, into `a`;
+// `from` is left empty.
+static void arena_merge(arena *a, arena *from) {
+  arena_chunk *tail = from->head;
+  if (tail == NULL) {
+    return;
+  }
+  while (tail->next != NULL) {
+    tail = tail->next;
+  }
+  tail->next = a->head;
+  a->head = from->head;
+  from->head = NULL;
+}
+
+static void *arena_alloc(arena *a, uint64_t size) {
+  size = (size + ARENA_ALIGN - 1) & ~(uint64_t)(ARENA_ALIGN - 1);
+  arena_chunk *chunk = a->head;
+  if (chunk == NULL || chunk->len + size > chunk->cap) {
+    uint64_t cap = a->chunk_size;
+    if (cap < size) {
+      cap = size;
+    }
+    chunk = allocator_alloc(a->allocator, sizeof(arena_chunk) + cap);
+    chunk->cap = cap;
+    chunk->len = 0;
+    chunk->next = a->head;
+    a->head = chunk;
+    if (a->chunk_size < ARENA_MAX_CHUNK) {
+      a->chunk_size <<= 1;
+    }
+  }
+  void *result = chunk->data + chunk->len;
+  chunk->len += size;
+  return result;
+}
+
+// Per-parse state. Values and strings come from `arena` when it is set,
+// otherwise from `allocator`; `scratch` is reused by every string decode. With
+// `insitu` set strings are decoded over the (writable) input through `view`
+// instead, and keep pointing into it. `depth` is the number of containers
+// already open around the text being parsed. Member names are taken from
+// `intern` when it is set (only for documents).
+typedef struct context context;
+
+struct context {
+  const char *end;
+  arena *arena;
+  buffer scratch;
+  bool insitu;
+  buffer view;
+  uint64_t depth;
+  const cj_allocator *allocator;
+  cj_intern *intern;
+};
+
+static void context_init(context *ctx, arena *a, const cj_allocator *allocator) {
+  ctx->end = NULL;
+  ctx->arena = a;
+  ctx->allocator = allocator;
+  ctx->intern = NULL;
+  buffer_init(&ctx->scratch, allocator);
+  ctx->insitu = false;
+  ctx->view.writer = NULL;
+  ctx->depth = 0;
+}
+
+static void context_clean(context *ctx) {
+  buffer_clean(&ctx->scratch);
+}
+
+static void *context_alloc(context *ctx, uint64_t size) {
+  if (ctx->arena != NULL) {
+    return arena_alloc(ctx->arena, size);
+  }
+  return allocator_alloc(ctx->allocator, size);
+}
+
+static void context_free_string(context *ctx, cj_string *string) {
+  if (ctx->arena == NULL && string != NULL) {
+    allocator_free(ctx->allocator, string, sizeof(cj_string) + string->len + 1);
+  }
+}
+
+static void context_free_value(context *ctx, cj_value *value) {
+  if (ctx->arena == NULL) {
+    cj_clean_with(value, ctx->allocator);
+  }
+}
+
+typedef struct container_node container_node;
+
+// A container as the library allocates it: the node, then the index, so
+// that scalars do not carry one. VALUE_CONTAINER in `flags` tells it from a
+// node built by hand.
+struct container_node {
+  cj_value value;
+  cj_index *index;
+};
+
+#define VALUE_CONTAINER 1
 
-static cj_value *create_cj_value(int type) {
-  cj_value *value = cj_malloc(sizeof(cj_value));
+static cj_value *create_cj_value(context *ctx, int type) {
+  cj_value *value;
+  if (type == CJ_TYPE_OBJECT || type == CJ_TYPE_ARRAY) {
+    container_node *node = context_alloc(ctx, sizeof(container_node));
+    node->index = NULL;
+    value = &node->value;
+  } else {
+    value = context_alloc(ctx, sizeof(cj_value));
+  }
   memset(value, 0, sizeof(cj_value));
   value->type = type;
+  value->flags = type == CJ_TYPE_OBJECT || type == CJ_TYPE_ARRAY ? VALUE_CONTAINER : 0;
   return value;
 }
 
-static void skip_whitespace(const char **pp) {
+static cj_index *value_index(const cj_value *value) {
+  return (value->flags & VALUE_CONTAINER) != 0 ? ((const container_node *)value)->index : NULL;
+}
+
+static uint64_t value_bytes(const cj_value *value) {
+  return (value->flags & VALUE_CONTAINER) != 0 ? sizeof(container_node) : sizeof(cj_value);
+}
+
+#define OBJECT_INDEX_MIN_MEMBERS 16
+#define ARRAY_INDEX_MIN_ELEMENTS 32
+
+typedef struct index_slot index_slot;
+
+struct index_slot {
+  uint64_t hash;
+  cj_value *member;
+};
+
+// Container index. For an array, `items` holds the elements in order. For an
+// object, `slots` is an open-addressing table keyed by member name; only the
+// first of duplicate names is entered, so lookups agree with a scan of the
+// member list.
+struct cj_index {
+  uint64_t size;
+  uint64_t mask;
+  cj_value **items;
+  index_slot *slots;
+};
+
+static uint64_t hash_bytes(const char *data, uint64_t len) {
+  uint64_t h = 0x9E3779B97F4A7C15ULL ^ len;
+  while (len >= 8) {
+    uint64_t word;
+    memcpy(&word, data, 8);
+    h = (h ^ word) * 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 29;
+    data += 8;
+    len -= 8;
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, data, len);
+  h = (h ^ tail) * 0x94D049BB133111EBULL;
+  h ^= h >> 32;
+  return h;
+}
+
+static bool name_equals(const cj_string *name, const char *key, uint64_t len) {
+  return name->len == len && memcmp(name->data, key, len) == 0;
+}
+
+// Builds the index of an object with `size` members, from the arena if one
+// is given.
+static cj_index *build_object_index(cj_value *object, uint64_t size, arena *a, const cj_allocator *allocator) {
+  uint64_t cap = 1;
+  while (cap < size * 2) {
+    cap <<= 1;
+  }
+  uint64_t bytes = sizeof(cj_index) + cap * sizeof(index_slot);
+  cj_index *index = a != NULL ? arena_alloc(a, bytes) : allocator_alloc(allocator, bytes);
+  index->size = size;
+  index->mask = cap - 1;
+  index->items = NULL;
+  index->slots = (index_slot *)(index + 1);
+  memset(index->slots, 0, cap * sizeof(index_slot));
+  cj_value *p = object->value.members;
+  for (; p != NULL; p = p->next) {
+    if (p->name == NULL) {
+      continue;
+    }
+    uint64_t hash = hash_bytes(p->name->data, p->name->len);
+    uint64_t i = hash & index->mask;
+    for (; index->slots[i].member != NULL; i = (i + 1) & index->mask) {
+      index_slot *slot = &index->slots[i];
+      if (slot->hash == hash && name_equals(slot->member->name, p->name->data, p->name->len)) {
+        break;
+      }
+    }
+    if (index->slots[i].member == NULL) {
+      index->slots[i].hash = hash;
+      index->slots[i].member = p;
+    }
+  }
+  return index;
+}
+
+static uint64_t count_members(const cj_value *container) {
+  uint64_t size = 0;
+  const cj_value *p = container->value.members;
+  for (; p != NULL; p = p->next) {
+    ++size;
+  }
+  return size;
+}
+
+// Builds the element vector of a non-empty array with `size` elements, from
+// the arena if one is given.
+static cj_index *build_array_index(cj_value *array, uint64_t size, arena *a, const cj_allocator *allocator) {
+  uint64_t bytes = sizeof(cj_index) + size * sizeof(cj_value *);
+  cj_index *index = a != NULL ? arena_alloc(a, bytes) : allocator_alloc(allocator, bytes);
+  index->size = size;
+  index->mask = 0;
+  index->items = (cj_value **)(index + 1);
+  index->slots = NULL;
+  uint64_t i = 0;
+  cj_value *p = array->value.elements;
+  for (; p != NULL; p = p->next) {
+    index->items[i++] = p;
+  }
+  return index;
+}
+
+// Size of the block an index was allocated in.
+static uint64_t index_bytes(const cj_index *index) {
+  if (index->items != NULL) {
+    return sizeof(cj_index) + index->size * sizeof(cj_value *);
+  }
+  return sizeof(cj_index) + (index->mask + 1) * sizeof(index_slot);
+}
+
+static cj_value *index_find(cj_index *index, const char *key, uint64_t len, uint64_t hash) {
+  uint64_t i = hash & index->mask;
+  for (; index->slots[i].member != NULL; i = (i + 1) & index->mask) {
+    index_slot *slot = &index->slots[i];
+    if (slot->hash == hash && name_equals(slot->member->name, key, len)) {
+      return slot->member;
+    }
+  }
+  return NULL;
+}
+
+#define INTERN_MIN_SLOTS 64
+
+typedef struct intern_entry intern_entry;
+
+// An interned name, with its hash kept just before it.
+struct intern_entry {
+  uint64_t hash;
+  cj_string string;
+};
+
+// Open-addressing set of names, at most half full. Entries come from
+// `strings`: the table's own arena when it is shared between documents,
+// or the arena of the one document being parsed.
+struct cj_intern {
+  arena arena;
+  arena *strings;
+  intern_entry **slots;
+  uint64_t mask;
+  uint64_t count;
+};
+
+static void intern_init(cj_intern *table, arena *strings) {
+  arena_init(&table->arena, NULL);
+  table->strings = strings != NULL ? strings : &table->arena;
+  table->mask = INTERN_MIN_SLOTS - 1;
+  table->count = 0;
+  table->slots = cj_malloc(INTERN_MIN_SLOTS * sizeof(intern_entry *));
+  memset(table->slots, 0, INTERN_MIN_SLOTS * sizeof(intern_entry *));
+}
+
+static void intern_clean(cj_intern *table) {
+  arena_clean(&table->arena);
+  cj_free(table->slots);
+}
+
+static void intern_grow(cj_intern *table) {
+  uint64_t cap = (table->mask + 1) << 1;
+  intern_entry **slots = cj_malloc(cap * sizeof(intern_entry *));
+  memset(slots, 0, cap * sizeof(intern_entry *));
+  for (uint64_t i = 0; i <= table->mask; ++i) {
+    intern_entry *entry = table->slots[i];
+    if (entry != NULL) {
+      uint64_t j = entry->hash & (cap - 1);
+      while (slots[j] != NULL) {
+        j = (j + 1) & (cap - 1);
+      }
+      slots[j] = entry;
+    }
+  }
+  cj_free(table->slots);
+  table->slots = slots;
+  table->mask = cap - 1;
+}
+
+// The entry for `key`, added if `add` is set; otherwise NULL if absent.
+static intern_entry *intern_lookup(cj_intern *table, const char *key, uint64_t len, bool add) {
+  uint64_t hash = hash_bytes(key, len);
+  uint64_t i = hash & table->mask;
+  for (; table->slots[i] != NULL; i = (i + 1) & table->mask) {
+    intern_entry *entry = table->slots[i];
+    if (entry->hash == hash && name_equals(&entry->string, key, len)) {
+      return entry;
+    }
+  }
+  if (!add) {
+    return NULL;
+  }
+  intern_entry *entry = arena_alloc(table->strings, sizeof(intern_entry) + len + 1);
+  entry->hash = hash;
+  entry->string.len = len;
+  entry->string.data = (char *)(entry + 1);
+  memcpy(entry->string.data, key, len);
+  entry->string.data[len] = '\0';
+  table->slots[i] = entry;
+  if (++table->count * 2 > table->mask) {
+    intern_grow(table);
+  }
+  return entry;
+}
+
+cj_intern *cj_intern_create(void) {
+  cj_intern *table = cj_malloc(sizeof(cj_intern));
+  intern_init(table, NULL);
+  return table;
+}
+
+void cj_intern_clean(cj_intern *table) {
+  if (table == NULL) {
+    return;
+  }
+  intern_clean(table);
+  cj_free(table);
+}
+
+const cj_string *cj_intern_find(cj_intern *table, const char *key, uint64_t len) {
+  intern_entry *entry = intern_lookup(table, key, len, false);
+  return entry != NULL ? &entry->string : NULL;
+}
+
+typedef struct parse_frame parse_frame;
+
+// An open container while parsing: values are appended after `tail`.
+struct parse_frame {
+  cj_value *container;
+  cj_value *tail;
+  uint64_t size;
+};
+
+// Opens a frame for `container`; fails once CJ_MAX_DEPTH are open.
+static bool parse_frame_push(parse_frame **stack, uint64_t *depth, uint64_t *cap, cj_value *container, const cj_allocator *allocator) {
+  if (*depth == CJ_MAX_DEPTH) {
+    return false;
+  }
+  if (*depth == *cap) {
+    uint64_t new_cap = *cap == 0 ? 16 : *cap << 1;
+    *stack = allocator_realloc(allocator, *stack, *cap * sizeof(parse_frame), new_cap * sizeof(parse_frame));
+    *cap = new_cap;
+  }
+  parse_frame *frame = &(*stack)[(*depth)++];
+  frame->container = container;
+  frame->tail = NULL;
+  frame->size = 0;
+  return true;
+}
+
+static void parse_frame_append(parse_frame *frame, cj_value *value) {
+  if (frame->tail != NULL) {
+    frame->tail->next = value;
+  } else {
+    frame->container->value.members = value;
+  }
+  frame->tail = value;
+  ++frame->size;
+}
+
+static void parse_frame_close(parse_frame *frame, context *ctx) {
+  cj_value *container = frame->container;
+  // documents never free nodes one by one, so they get every index up front
+  // in the arena. Other trees, whatever allocator they came from, only get
+  // the vectors of long arrays, which a walk would make quadratic to index
+  // through; the rest come from cj_index_build_with
+  if (container->type == CJ_TYPE_ARRAY) {
+    if (ctx->arena != NULL || frame->size >= ARRAY_INDEX_MIN_ELEMENTS) {
+      ((container_node *)container)->index = build_array_index(container, frame->size, ctx->arena, ctx->allocator);
+    }
+  } else if (ctx->arena != NULL && frame->size >= OBJECT_INDEX_MIN_MEMBERS) {
+    ((container_node *)container)->index = build_object_index(container, frame->size, ctx->arena, ctx->allocator);
+  }
+}
+
+// The byte at p, or '\0' at the end of the input. '\0' never continues a
+// token, so a bounded input ends exactly like a NUL-terminated one.
+static inline char peek(const char *p, const char *end) {
+  return p < end ? *p : '\0';
+}
+
+static void skip_whitespace(const char **pp, const char *end) {
   const char *p = *pp;
-  while (
+  while (p < end && (
     *p == ' ' ||
     *p == '\t' ||
     *p == '\n' ||
     *p == '\r'
-  ) {
+  )) {
     ++p;
   }
   *pp = p;
 }
 
-static double parse_number_raw(const char **pp, bool *ok) {
+#define POW5_MIN_EXP (-342)
+#define POW5_MAX_EXP 308
+#define MAX_FALLBACK_DIGITS 768
+
+// 128-bit truncated significands of 5^q for q in [-342, 308], high word
+// first, as used by the Eisel-Lemire algorithm.
+static const uint64_t pow5_128[] = {
+  0xeef453d6923bd65a, 0x113faa2906a13b3f,
+  0x9558b4661b6565f8, 0x4ac7ca59a424c507,
+  0xbaaee17fa23ebf76, 0x5d79bcf00d2df649,
+  0xe95a99df8ace6f53, 0xf4d82c2c107973dc,
+  0x91d8a02bb6c10594, 0x79071b9b8a4be869,
+  0xb64ec836a47146f9, 0x9748e2826cdee284,
+  0xe3e27a444d8d98b7, 0xfd1b1b2308169b25,
+  0x8e6d8c6ab0787f72, 0xfe30f0f5e50e20f7,
+  0xb208ef855c969f4f, 0xbdbd2d335e51a935,
+  0xde8b2b66b3bc4723, 0xad2c788035e61382,
+  0x8b16fb203055ac76, 0x4c3bcb5021afcc31,
+  0xaddcb9e83c6b1793, 0xdf4abe242a1bbf3d,
+  0xd953e8624b85dd78, 0xd71d6dad34a2af0d,
+  0x87d4713d6f33aa6b, 0x8672648c40e5ad68,
+  0xa9c98d8ccb009506, 0x680efdaf511f18c2,
+  0xd43bf0effdc0ba48, 0x0212bd1b2566def2,
+  0x84a57695fe98746d, 0x014bb630f7604b57,
+  0xa5ced43b7e3e9188, 0x419ea3bd35385e2d,
+  0xcf42894a5dce35ea, 0x52064cac828675b9,
+  0x818995ce7aa0e1b2, 0x7343efebd1940993,
+  0xa1ebfb4219491a1f, 0x1014ebe6c5f90bf8,
+  0xca66fa129f9b60a6, 0xd41a26e077774ef6,
+  0xfd00b897478238d0, 0x8920b098955522b4,
+  0x9e20735e8cb16382, 0x55b46e5f5d5535b0,
+  0xc5a890362fddbc62, 0xeb2189f734aa831d,
+  0xf712b443bbd52b7b, 0xa5e9ec7501d523e4,
+  0x9a6bb0aa55653b2d, 0x47b233c92125366e,
+  0xc1069cd4eabe89f8, 0x999ec0bb696e840a,
+  0xf148440a256e2c76, 0xc00670ea43ca250d,
+  0x96cd2a865764dbca, 0x380406926a5e5728,
+  0xbc807527ed3e12bc, 0xc605083704f5ecf2,
+  0xeba09271e88d976b, 0xf7864a44c633682e,
+  0x93445b8731587ea3, 0x7ab3ee6afbe0211d,
+  0xb8157268fdae9e4c, 0x5960ea05bad82964,
+  0xe61acf033d1a45df, 0x6fb92487298e33bd,
+  0x8fd0c16206306bab, 0xa5d3b6d479f8e056,
+  0xb3c4f1ba87bc8696, 0x8f48a4899877186c,
+  0xe0b62e2929aba83c, 0x331acdabfe94de87,
+  0x8c71dcd9ba0b4925, 0x9ff0c08b7f1d0b14,
+  0xaf8e5410288e1b6f, 0x07ecf0ae5ee44dd9,
+  0xdb71e91432b1a24a, 0xc9e82cd9f69d6150,
+  0x892731ac9faf056e, 0xbe311c083a225cd2,
+  0xab70fe17c79ac6ca, 0x6dbd630a48aaf406,
+  0xd64d3d9db981787d, 0x092cbbccdad5b108,
+  0x85f0468293f0eb4e, 0x25bbf56008c58ea5,
+  0xa76c582338ed2621, 0xaf2af2b80af6f24e,
+  0xd1476e2c07286faa, 0x1af5af660db4aee1,
+  0x82cca4db847945ca, 0x50d98d9fc890ed4d,
+  0xa37fce126597973c, 0xe50ff107bab528a0,
+  0xcc5fc196fefd7d0c, 0x1e53ed49a96272c8,
+  0xff77b1fcbebcdc4f, 0x25e8e89c13bb0f7a,
+  0x9faacf3df73609b1, 0x77b191618c54e9ac,
+  0xc795830d75038c1d, 0xd59df5b9ef6a2417,
+  0xf97ae3d0d2446f25, 0x4b0573286b44ad1d,
+  0x9becce62836ac577, 0x4ee367f9430aec32,
+  0xc2e801fb244576d5, 0x229c41f793cda73f,
+  0xf3a20279ed56d48a, 0x6b43527578c1110f,
+  0x9845418c345644d6, 0x830a13896b78aaa9,
+  0xbe5691ef416bd60c, 0x23cc986bc656d553,
+  0xedec366b11c6cb8f, 0x2cbfbe86b7ec8aa8,
+  0x94b3a202eb1c3f39, 0x7bf7d71432f3d6a9,
+  0xb9e08a83a5e34f07, 0xdaf5ccd93fb0cc53,
+  0xe858ad248f5c22c9, 0xd1b3400f8f9cff68,
+  0x91376c36d99995be, 0x23100809b9c21fa1,
+  0xb58547448ffffb2d, 0xabd40a0c2832a78a,
+  0xe2e69915b3fff9f9, 0x16c90c8f323f516c,
+  0x8dd01fad907ffc3b, 0xae3da7d97f6792e3,
+  0xb1442798f49ffb4a, 0x99cd11cfdf41779c,
+  0xdd95317f31c7fa1d, 0x40405643d711d583,
+  0x8a7d3eef7f1cfc52, 0x482835ea666b2572,
+  0xad1c8eab5ee43b66, 0xda3243650005eecf,
+  0xd863b256369d4a40, 0x90bed43e40076a82,
+  0x873e4f75e2224e68, 0x5a7744a6e804a291,
+  0xa90de3535aaae202, 0x711515d0a205cb36,
+  0xd3515c2831559a83, 0x0d5a5b44ca873e03,
+  0x8412d9991ed58091, 0xe858790afe9486c2,
+  0xa5178fff668ae0b6, 0x626e974dbe39a872,
+  0xce5d73ff402d98e3, 0xfb0a3d212dc8128f,
+  0x80fa687f881c7f8e, 0x7ce66634bc9d0b99,
+  0xa139029f6a239f72, 0x1c1fffc1ebc44e80,
+  0xc987434744ac874e, 0xa327ffb266b56220,
+  0xfbe9141915d7a922, 0x4bf1ff9f0062baa8,
+  0x9d71ac8fada6c9b5, 0x6f773fc3603db4a9,
+  0xc4ce17b399107c22, 0xcb550fb4384d21d3,
+  0xf6019da07f549b2b, 0x7e2a53a146606a48,
+  0x99c102844f94e0fb, 0x2eda7444cbfc426d,
+  0xc0314325637a1939, 0xfa911155fefb5308,
+  0xf03d93eebc589f88, 0x793555ab7eba27ca,
+  0x96267c7535b763b5, 0x4bc1558b2f3458de,
+  0xbbb01b9283253ca2, 0x9eb1aaedfb016f16,
+  0xea9c227723ee8bcb, 0x465e15a979c1cadc,
+  0x92a1958a7675175f, 0x0bfacd89ec191ec9,
+  0xb749faed14125d36, 0xcef980ec671f667b,
+  0xe51c79a85916f484, 0x82b7e12780e7401a,
+  0x8f31cc0937ae58d2, 0xd1b2ecb8b0908810,
+  0xb2fe3f0b8599ef07, 0x861fa7e6dcb4aa15,
+  0xdfbdcece67006ac9, 0x67a791e093e1d49a,
+  0x8bd6a141006042bd, 0xe0c8bb2c5c6d24e0,
+  0xaecc49914078536d, 0x58fae9f773886e18,
+  0xda7f5bf590966848, 0xaf39a475506a899e,
+  0x888f99797a5e012d, 0x6d8406c952429603,
+  0xaab37fd7d8f58178, 0xc8e5087ba6d33b83,
+  0xd5605fcdcf32e1d6, 0xfb1e4a9a90880a64,
+  0x855c3be0a17fcd26, 0x5cf2eea09a55067f,
+  0xa6b34ad8c9dfc06f, 0xf42faa48c0ea481e,
+  0xd0601d8efc57b08b, 0xf13b94daf124da26,
+  0x823c12795db6ce57, 0x76c53d08d6b70858,
+  0xa2cb1717b52481ed, 0x54768c4b0c64ca6e,
+  0xcb7ddcdda26da268, 0xa9942f5dcf7dfd09,
+  0xfe5d54150b090b02, 0xd3f93b35435d7c4c,
+  0x9efa548d26e5a6e1, 0xc47bc5014a1a6daf,
+  0xc6b8e9b0709f109a, 0x359ab6419ca1091b,
+  0xf867241c8cc6d4c0, 0xc30163d203c94b62,
+  0x9b407691d7fc44f8, 0x79e0de63425dcf1d,
+  0xc21094364dfb5636, 0x985915fc12f542e4,
+  0xf294b943e17a2bc4, 0x3e6f5b7b17b2939d,
+  0x979cf3ca6cec5b5a, 0xa705992ceecf9c42,
+  0xbd8430bd08277231, 0x50c6ff782a838353,
+  0xece53cec4a314ebd, 0xa4f8bf5635246428,
+  0x940f4613ae5ed136, 0x871b7795e136be99,
+  0xb913179899f68584, 0x28e2557b59846e3f,
+  0xe757dd7ec07426e5, 0x331aeada2fe589cf,
+  0x9096ea6f3848984f, 0x3ff0d2c85def7621,
+  0xb4bca50b065abe63, 0x0fed077a756b53a9,
+  0xe1ebce4dc7f16dfb, 0xd3e8495912c62894,
+  0x8d3360f09cf6e4bd, 0x64712dd7abbbd95c,
+  0xb080392cc4349dec, 0xbd8d794d96aacfb3,
+  0xdca04777f541c567, 0xecf0d7a0fc5583a0,
+  0x89e42caaf9491b60, 0xf41686c49db57244,
+  0xac5d37d5b79b6239, 0x311c2875c522ced5,
+  0xd77485cb25823ac7, 0x7d633293366b828b,
+  0x86a8d39ef77164bc, 0xae5dff9c02033197,
+  0xa8530886b54dbdeb, 0xd9f57f830283fdfc,
+  0xd267caa862a12d66, 0xd072df63c324fd7b,
+  0x8380dea93da4bc60, 0x4247cb9e59f71e6d,
+  0xa46116538d0deb78, 0x52d9be85f074e608,
+  0xcd795be870516656, 0x67902e276c921f8b,
+  0x806bd9714632dff6, 0x00ba1cd8a3db53b6,
+  0xa086cfcd97bf97f3, 0x80e8a40eccd228a4,
+  0xc8a883c0fdaf7df0, 0x6122cd128006b2cd,
+  0xfad2a4b13d1b5d6c, 0x796b805720085f81,
+  0x9cc3a6eec6311a63, 0xcbe3303674053bb0,
+  0xc3f490aa77bd60fc, 0xbedbfc4411068a9c,
+  0xf4f1b4d515acb93b, 0xee92fb5515482d44,
+  0x991711052d8bf3c5, 0x751bdd152d4d1c4a,
+  0xbf5cd54678eef0b6, 0xd262d45a78a0635d,
+  0xef340a98172aace4, 0x86fb897116c87c34,
+  0x9580869f0e7aac0e, 0xd45d35e6ae3d4da0,
+  0xbae0a846d2195712, 0x8974836059cca109,
+  0xe998d258869facd7, 0x2bd1a438703fc94b,
+  0x91ff83775423cc06, 0x7b6306a34627ddcf,
+  0xb67f6455292cbf08, 0x1a3bc84c17b1d542,
+  0xe41f3d6a7377eeca, 0x20caba5f1d9e4a93,
+  0x8e938662882af53e, 0x547eb47b7282ee9c,
+  0xb23867fb2a35b28d, 0xe99e619a4f23aa43,
+  0xdec681f9f4c31f31, 0x6405fa00e2ec94d4,
+  0x8b3c113c38f9f37e, 0xde83bc408dd3dd04,
+  0xae0b158b4738705e, 0x9624ab50b148d445,
+  0xd98ddaee19068c76, 0x3badd624dd9b0957,
+  0x87f8a8d4cfa417c9, 0xe54ca5d70a80e5d6,
+  0xa9f6d30a038d1dbc, 0x5e9fcf4ccd211f4c,
+  0xd47487cc8470652b, 0x7647c3200069671f,
+  0x84c8d4dfd2c63f3b, 0x29ecd9f40041e073,
+  0xa5fb0a17c777cf09, 0xf468107100525890,
+  0xcf79cc9db955c2cc, 0x7182148d4066eeb4,
+  0x81ac1fe293d599bf, 0xc6f14cd848405530,
+  0xa21727db38cb002f, 0xb8ada00e5a506a7c,
+  0xca9cf1d206fdc03b, 0xa6d90811f0e4851c,
+  0xfd442e4688bd304a, 0x908f4a166d1da663,
+  0x9e4a9cec15763e2e, 0x9a598e4e043287fe,
+  0xc5dd44271ad3cdba, 0x40eff1e1853f29fd,
+  0xf7549530e188c128, 0xd12bee59e68ef47c,
+  0x9a94dd3e8cf578b9, 0x82bb74f8301958ce,
+  0xc13a148e3032d6e7, 0xe36a52363c1faf01,
+  0xf18899b1bc3f8ca1, 0xdc44e6c3cb279ac1,
+  0x96f5600f15a7b7e5, 0x29ab103a5ef8c0b9,
+  0xbcb2b812db11a5de, 0x7415d448f6b6f0e7,
+  0xebdf661791d60f56, 0x111b495b3464ad21,
+  0x936b9fcebb25c995, 0xcab10dd900beec34,
+  0xb84687c269ef3bfb, 0x3d5d514f40eea742,
+  0xe65829b3046b0afa, 0x0cb4a5a3112a5112,
+  0x8ff71a0fe2c2e6dc, 0x47f0e785eaba72ab,
+  0xb3f4e093db73a093, 0x59ed216765690f56,
+  0xe0f218b8d25088b8, 0x306869c13ec3532c,
+  0x8c974f7383725573, 0x1e414218c73a13fb,
+  0xafbd2350644eeacf, 0xe5d1929ef90898fa,
+  0xdbac6c247d62a583, 0xdf45f746b74abf39,
+  0x894bc396ce5da772, 0x6b8bba8c328eb783,
+  0xab9eb47c81f5114f, 0x066ea92f3f326564,
+  0xd686619ba27255a2, 0xc80a537b0efefebd,
+  0x8613fd0145877585, 0xbd06742ce95f5f36,
+  0xa798fc4196e952e7, 0x2c48113823b73704,
+  0xd17f3b51fca3a7a0, 0xf75a15862ca504c5,
+  0x82ef85133de648c4, 0x9a984d73dbe722fb,
+  0xa3ab66580d5fdaf5, 0xc13e60d0d2e0ebba,
+  0xcc963fee10b7d1b3, 0x318df905079926a8,
+  0xffbbcfe994e5c61f, 0xfdf17746497f7052,
+  0x9fd561f1fd0f9bd3, 0xfeb6ea8bedefa633,
+  0xc7caba6e7c5382c8, 0xfe64a52ee96b8fc0,
+  0xf9bd690a1b68637b, 0x3dfdce7aa3c673b0,
+  0x9c1661a651213e2d, 0x06bea10ca65c084e,
+  0xc31bfa0fe5698db8, 0x486e494fcff30a62,
+  0xf3e2f893dec3f126, 0x5a89dba3c3efccfa,
+  0x986ddb5c6b3a76b7, 0xf89629465a75e01c,
+  0xbe89523386091465, 0xf6bbb397f1135823,
+  0xee2ba6c0678b597f, 0x746aa07ded582e2c,
+  0x94db483840b717ef, 0xa8c2a44eb4571cdc,
+  0xba121a4650e4ddeb, 0x92f34d62616ce413,
+  0xe896a0d7e51e1566, 0x77b020baf9c81d17,
+  0x915e2486ef32cd60, 0x0ace1474dc1d122e,
+  0xb5b5ada8aaff80b8, 0x0d819992132456ba,
+  0xe3231912d5bf60e6, 0x10e1fff697ed6c69,
+  0x8df5efabc5979c8f, 0xca8d3ffa1ef463c1,
+  0xb1736b96b6fd83b3, 0xbd308ff8a6b17cb2,
+  0xddd0467c64bce4a0, 0xac7cb3f6d05ddbde,
+  0x8aa22c0dbef60ee4, 0x6bcdf07a423aa96b,
+  0xad4ab7112eb3929d, 0x86c16c98d2c953c6,
+  0xd89d64d57a607744, 0xe871c7bf077ba8b7,
+  0x87625f056c7c4a8b, 0x11471cd764ad4972,
+  0xa93af6c6c79b5d2d, 0xd598e40d3dd89bcf,
+  0xd389b47879823479, 0x4aff1d108d4ec2c3,
+  0x843610cb4bf160cb, 0xcedf722a585139ba,
+  0xa54394fe1eedb8fe, 0xc2974eb4ee658828,
+  0xce947a3da6a9273e, 0x733d226229feea32,
+  0x811ccc668829b887, 0x0806357d5a3f525f,
+  0xa163ff802a3426a8, 0xca07c2dcb0cf26f7,
+  0xc9bcff6034c13052, 0xfc89b393dd02f0b5,
+  0xfc2c3f3841f17c67, 0xbbac2078d443ace2,
+  0x9d9ba7832936edc0, 0xd54b944b84aa4c0d,
+  0xc5029163f384a931, 0x0a9e795e65d4df11,
+  0xf64335bcf065d37d, 0x4d4617b5ff4a16d5,
+  0x99ea0196163fa42e, 0x504bced1bf8e4e45,
+  0xc06481fb9bcf8d39, 0xe45ec2862f71e1d6,
+  0xf07da27a82c37088, 0x5d767327bb4e5a4c,
+  0x964e858c91ba2655, 0x3a6a07f8d510f86f,
+  0xbbe226efb628afea, 0x890489f70a55368b,
+  0xeadab0aba3b2dbe5, 0x2b45ac74ccea842e,
+  0x92c8ae6b464fc96f, 0x3b0b8bc90012929d,
+  0xb77ada0617e3bbcb, 0x09ce6ebb40173744,
+  0xe55990879ddcaabd, 0xcc420a6a101d0515,
+  0x8f57fa54c2a9eab6, 0x9fa946824a12232d,
+  0xb32df8e9f3546564, 0x47939822dc96abf9,
+  0xdff9772470297ebd, 0x59787e2b93bc56f7,
+  0x8bfbea76c619ef36, 0x57eb4edb3c55b65a,
+  0xaefae51477a06b03, 0xede622920b6b23f1,
+  0xdab99e59958885c4, 0xe95fab368e45eced,
+  0x88b402f7fd75539b, 0x11dbcb0218ebb414,
+  0xaae103b5fcd2a881, 0xd652bdc29f26a119,
+  0xd59944a37c0752a2, 0x4be76d3346f0495f,
+  0x857fcae62d8493a5, 0x6f70a4400c562ddb,
+  0xa6dfbd9fb8e5b88e, 0xcb4ccd500f6bb952,
+  0xd097ad07a71f26b2, 0x7e2000a41346a7a7,
+  0x825ecc24c873782f, 0x8ed400668c0c28c8,
+  0xa2f67f2dfa90563b, 0x728900802f0f32fa,
+  0xcbb41ef979346bca, 0x4f2b40a03ad2ffb9,
+  0xfea126b7d78186bc, 0xe2f610c84987bfa8,
+  0x9f24b832e6b0f436, 0x0dd9ca7d2df4d7c9,
+  0xc6ede63fa05d3143, 0x91503d1c79720dbb,
+  0xf8a95fcf88747d94, 0x75a44c6397ce912a,
+  0x9b69dbe1b548ce7c, 0xc986afbe3ee11aba,
+  0xc24452da229b021b, 0xfbe85badce996168,
+  0xf2d56790ab41c2a2, 0xfae27299423fb9c3,
+  0x97c560ba6b0919a5, 0xdccd879fc967d41a,
+  0xbdb6b8e905cb600f, 0x5400e987bbc1c920,
+  0xed246723473e3813, 0x290123e9aab23b68,
+  0x9436c0760c86e30b, 0xf9a0b6720aaf6521,
+  0xb94470938fa89bce, 0xf808e40e8d5b3e69,
+  0xe7958cb87392c2c2, 0xb60b1d1230b20e04,
+  0x90bd77f3483bb9b9, 0xb1c6f22b5e6f48c2,
+  0xb4ecd5f01a4aa828, 0x1e38aeb6360b1af3,
+  0xe2280b6c20dd5232, 0x25c6da63c38de1b0,
+  0x8d590723948a535f, 0x579c487e5a38ad0e,
+  0xb0af48ec79ace837, 0x2d835a9df0c6d851,
+  0xdcdb1b2798182244, 0xf8e431456cf88e65,
+  0x8a08f0f8bf0f156b, 0x1b8e9ecb641b58ff,
+  0xac8b2d36eed2dac5, 0xe272467e3d222f3f,
+  0xd7adf884aa879177, 0x5b0ed81dcc6abb0f,
+  0x86ccbb52ea94baea, 0x98e947129fc2b4e9,
+  0xa87fea27a539e9a5, 0x3f2398d747b36224,
+  0xd29fe4b18e88640e, 0x8eec7f0d19a03aad,
+  0x83a3eeeef9153e89, 0x1953cf68300424ac,
+  0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7,
+  0xcdb02555653131b6, 0x3792f412cb06794d,
+  0x808e17555f3ebf11, 0xe2bbd88bbee40bd0,
+  0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4,
+  0xc8de047564d20a8b, 0xf245825a5a445275,
+  0xfb158592be068d2e, 0xeed6e2f0f0d56712,
+  0x9ced737bb6c4183d, 0x55464dd69685606b,
+  0xc428d05aa4751e4c, 0xaa97e14c3c26b886,
+  0xf53304714d9265df, 0xd53dd99f4b3066a8,
+  0x993fe2c6d07b7fab, 0xe546a8038efe4029,
+  0xbf8fdb78849a5f96, 0xde98520472bdd033,
+  0xef73d256a5c0f77c, 0x963e66858f6d4440,
+  0x95a8637627989aad, 0xdde7001379a44aa8,
+  0xbb127c53b17ec159, 0x5560c018580d5d52,
+  0xe9d71b689dde71af, 0xaab8f01e6e10b4a6,
+  0x9226712162ab070d, 0xcab3961304ca70e8,
+  0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22,
+  0xe45c10c42a2b3b05, 0x8cb89a7db77c506a,
+  0x8eb98a7a9a5b04e3, 0x77f3608e92adb242,
+  0xb267ed1940f1c61c, 0x55f038b237591ed3,
+  0xdf01e85f912e37a3, 0x6b6c46dec52f6688,
+  0x8b61313bbabce2c6, 0x2323ac4b3b3da015,
+  0xae397d8aa96c1b77, 0xabec975e0a0d081a,
+  0xd9c7dced53c72255, 0x96e7bd358c904a21,
+  0x881cea14545c7575, 0x7e50d64177da2e54,
+  0xaa242499697392d2, 0xdde50bd1d5d0b9e9,
+  0xd4ad2dbfc3d07787, 0x955e4ec64b44e864,
+  0x84ec3c97da624ab4, 0xbd5af13bef0b113e,
+  0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e,
+  0xcfb11ead453994ba, 0x67de18eda5814af2,
+  0x81ceb32c4b43fcf4, 0x80eacf948770ced7,
+  0xa2425ff75e14fc31, 0xa1258379a94d028d,
+  0xcad2f7f5359a3b3e, 0x096ee45813a04330,
+  0xfd87b5f28300ca0d, 0x8bca9d6e188853fc,
+  0x9e74d1b791e07e48, 0x775ea264cf55347e,
+  0xc612062576589dda, 0x95364afe032a819e,
+  0xf79687aed3eec551, 0x3a83ddbd83f52205,
+  0x9abe14cd44753b52, 0xc4926a9672793543,
+  0xc16d9a0095928a27, 0x75b7053c0f178294,
+  0xf1c90080baf72cb1, 0x5324c68b12dd6339,
+  0x971da05074da7bee, 0xd3f6fc16ebca5e04,
+  0xbce5086492111aea, 0x88f4bb1ca6bcf585,
+  0xec1e4a7db69561a5, 0x2b31e9e3d06c32e6,
+  0x9392ee8e921d5d07, 0x3aff322e62439fd0,
+  0xb877aa3236a4b449, 0x09befeb9fad487c3,
+  0xe69594bec44de15b, 0x4c2ebe687989a9b4,
+  0x901d7cf73ab0acd9, 0x0f9d37014bf60a11,
+  0xb424dc35095cd80f, 0x538484c19ef38c95,
+  0xe12e13424bb40e13, 0x2865a5f206b06fba,
+  0x8cbccc096f5088cb, 0xf93f87b7442e45d4,
+  0xafebff0bcb24aafe, 0xf78f69a51539d749,
+  0xdbe6fecebdedd5be, 0xb573440e5a884d1c,
+  0x89705f4136b4a597, 0x31680a88f8953031,
+  0xabcc77118461cefc, 0xfdc20d2b36ba7c3e,
+  0xd6bf94d5e57a42bc, 0x3d32907604691b4d,
+  0x8637bd05af6c69b5, 0xa63f9a49c2c1b110,
+  0xa7c5ac471b478423, 0x0fcf80dc33721d54,
+  0xd1b71758e219652b, 0xd3c36113404ea4a9,
+  0x83126e978d4fdf3b, 0x645a1cac083126ea,
+  0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a4,
+  0xcccccccccccccccc, 0xcccccccccccccccd,
+  0x8000000000000000, 0x0000000000000000,
+  0xa000000000000000, 0x0000000000000000,
+  0xc800000000000000, 0x0000000000000000,
+  0xfa00000000000000, 0x0000000000000000,
+  0x9c40000000000000, 0x0000000000000000,
+  0xc350000000000000, 0x0000000000000000,
+  0xf424000000000000, 0x0000000000000000,
+  0x9896800000000000, 0x0000000000000000,
+  0xbebc200000000000, 0x0000000000000000,
+  0xee6b280000000000, 0x0000000000000000,
+  0x9502f90000000000, 0x0000000000000000,
+  0xba43b74000000000, 0x0000000000000000,
+  0xe8d4a51000000000, 0x0000000000000000,
+  0x9184e72a00000000, 0x0000000000000000,
+  0xb5e620f480000000, 0x0000000000000000,
+  0xe35fa931a0000000, 0x0000000000000000,
+  0x8e1bc9bf04000000, 0x0000000000000000,
+  0xb1a2bc2ec5000000, 0x0000000000000000,
+  0xde0b6b3a76400000, 0x0000000000000000,
+  0x8ac7230489e80000, 0x0000000000000000,
+  0xad78ebc5ac620000, 0x0000000000000000,
+  0xd8d726b7177a8000, 0x0000000000000000,
+  0x878678326eac9000, 0x0000000000000000,
+  0xa968163f0a57b400, 0x0000000000000000,
+  0xd3c21bcecceda100, 0x0000000000000000,
+  0x84595161401484a0, 0x0000000000000000,
+  0xa56fa5b99019a5c8, 0x0000000000000000,
+  0xcecb8f27f4200f3a, 0x0000000000000000,
+  0x813f3978f8940984, 0x4000000000000000,
+  0xa18f07d736b90be5, 0x5000000000000000,
+  0xc9f2c9cd04674ede, 0xa400000000000000,
+  0xfc6f7c4045812296, 0x4d00000000000000,
+  0x9dc5ada82b70b59d, 0xf020000000000000,
+  0xc5371912364ce305, 0x6c28000000000000,
+  0xf684df56c3e01bc6, 0xc732000000000000,
+  0x9a130b963a6c115c, 0x3c7f400000000000,
+  0xc097ce7bc90715b3, 0x4b9f100000000000,
+  0xf0bdc21abb48db20, 0x1e86d40000000000,
+  0x96769950b50d88f4, 0x1314448000000000,
+  0xbc143fa4e250eb31, 0x17d955a000000000,
+  0xeb194f8e1ae525fd, 0x5dcfab0800000000,
+  0x92efd1b8d0cf37be, 0x5aa1cae500000000,
+  0xb7abc627050305ad, 0xf14a3d9e40000000,
+  0xe596b7b0c643c719, 0x6d9ccd05d0000000,
+  0x8f7e32ce7bea5c6f, 0xe4820023a2000000,
+  0xb35dbf821ae4f38b, 0xdda2802c8a800000,
+  0xe0352f62a19e306e, 0xd50b2037ad200000,
+  0x8c213d9da502de45, 0x4526f422cc340000,
+  0xaf298d050e4395d6, 0x9670b12b7f410000,
+  0xdaf3f04651d47b4c, 0x3c0cdd765f114000,
+  0x88d8762bf324cd0f, 0xa5880a69fb6ac800,
+  0xab0e93b6efee0053, 0x8eea0d047a457a00,
+  0xd5d238a4abe98068, 0x72a4904598d6d880,
+  0x85a36366eb71f041, 0x47a6da2b7f864750,
+  0xa70c3c40a64e6c51, 0x999090b65f67d924,
+  0xd0cf4b50cfe20765, 0xfff4b4e3f741cf6d,
+  0x82818f1281ed449f, 0xbff8f10e7a8921a4,
+  0xa321f2d7226895c7, 0xaff72d52192b6a0d,
+  0xcbea6f8ceb02bb39, 0x9bf4f8a69f764490,
+  0xfee50b7025c36a08, 0x02f236d04753d5b4,
+  0x9f4f2726179a2245, 0x01d762422c946590,
+  0xc722f0ef9d80aad6, 0x424d3ad2b7b97ef5,
+  0xf8ebad2b84e0d58b, 0xd2e0898765a7deb2,
+  0x9b934c3b330c8577, 0x63cc55f49f88eb2f,
+  0xc2781f49ffcfa6d5, 0x3cbf6b71c76b25fb,
+  0xf316271c7fc3908a, 0x8bef464e3945ef7a,
+  0x97edd871cfda3a56, 0x97758bf0e3cbb5ac,
+  0xbde94e8e43d0c8ec, 0x3d52eeed1cbea317,
+  0xed63a231d4c4fb27, 0x4ca7aaa863ee4bdd,
+  0x945e455f24fb1cf8, 0x8fe8caa93e74ef6a,
+  0xb975d6b6ee39e436, 0xb3e2fd538e122b44,
+  0xe7d34c64a9c85d44, 0x60dbbca87196b616,
+  0x90e40fbeea1d3a4a, 0xbc8955e946fe31cd,
+  0xb51d13aea4a488dd, 0x6babab6398bdbe41,
+  0xe264589a4dcdab14, 0xc696963c7eed2dd1,
+  0x8d7eb76070a08aec, 0xfc1e1de5cf543ca2,
+  0xb0de65388cc8ada8, 0x3b25a55f43294bcb,
+  0xdd15fe86affad912, 0x49ef0eb713f39ebe,
+  0x8a2dbf142dfcc7ab, 0x6e3569326c784337,
+  0xacb92ed9397bf996, 0x49c2c37f07965404,
+  0xd7e77a8f87daf7fb, 0xdc33745ec97be906,
+  0x86f0ac99b4e8dafd, 0x69a028bb3ded71a3,
+  0xa8acd7c0222311bc, 0xc40832ea0d68ce0c,
+  0xd2d80db02aabd62b, 0xf50a3fa490c30190,
+  0x83c7088e1aab65db, 0x792667c6da79e0fa,
+  0xa4b8cab1a1563f52, 0x577001b891185938,
+  0xcde6fd5e09abcf26, 0xed4c0226b55e6f86,
+  0x80b05e5ac60b6178, 0x544f8158315b05b4,
+  0xa0dc75f1778e39d6, 0x696361ae3db1c721,
+  0xc913936dd571c84c, 0x03bc3a19cd1e38e9,
+  0xfb5878494ace3a5f, 0x04ab48a04065c723,
+  0x9d174b2dcec0e47b, 0x62eb0d64283f9c76,
+  0xc45d1df942711d9a, 0x3ba5d0bd324f8394,
+  0xf5746577930d6500, 0xca8f44ec7ee36479,
+  0x9968bf6abbe85f20, 0x7e998b13cf4e1ecb,
+  0xbfc2ef456ae276e8, 0x9e3fedd8c321a67e,
+  0xefb3ab16c59b14a2, 0xc5cfe94ef3ea101e,
+  0x95d04aee3b80ece5, 0xbba1f1d158724a12,
+  0xbb445da9ca61281f, 0x2a8a6e45ae8edc97,
+  0xea1575143cf97226, 0xf52d09d71a3293bd,
+  0x924d692ca61be758, 0x593c2626705f9c56,
+  0xb6e0c377cfa2e12e, 0x6f8b2fb00c77836c,
+  0xe498f455c38b997a, 0x0b6dfb9c0f956447,
+  0x8edf98b59a373fec, 0x4724bd4189bd5eac,
+  0xb2977ee300c50fe7, 0x58edec91ec2cb657,
+  0xdf3d5e9bc0f653e1, 0x2f2967b66737e3ed,
+  0x8b865b215899f46c, 0xbd79e0d20082ee74,
+  0xae67f1e9aec07187, 0xecd8590680a3aa11,
+  0xda01ee641a708de9, 0xe80e6f4820cc9495,
+  0x884134fe908658b2, 0x3109058d147fdcdd,
+  0xaa51823e34a7eede, 0xbd4b46f0599fd415,
+  0xd4e5e2cdc1d1ea96, 0x6c9e18ac7007c91a,
+  0x850fadc09923329e, 0x03e2cf6bc604ddb0,
+  0xa6539930bf6bff45, 0x84db8346b786151c,
+  0xcfe87f7cef46ff16, 0xe612641865679a63,
+  0x81f14fae158c5f6e, 0x4fcb7e8f3f60c07e,
+  0xa26da3999aef7749, 0xe3be5e330f38f09d,
+  0xcb090c8001ab551c, 0x5cadf5bfd3072cc5,
+  0xfdcb4fa002162a63, 0x73d9732fc7c8f7f6,
+  0x9e9f11c4014dda7e, 0x2867e7fddcdd9afa,
+  0xc646d63501a1511d, 0xb281e1fd541501b8,
+  0xf7d88bc24209a565, 0x1f225a7ca91a4226,
+  0x9ae757596946075f, 0x3375788de9b06958,
+  0xc1a12d2fc3978937, 0x0052d6b1641c83ae,
+  0xf209787bb47d6b84, 0xc0678c5dbd23a49a,
+  0x9745eb4d50ce6332, 0xf840b7ba963646e0,
+  0xbd176620a501fbff, 0xb650e5a93bc3d898,
+  0xec5d3fa8ce427aff, 0xa3e51f138ab4cebe,
+  0x93ba47c980e98cdf, 0xc66f336c36b10137,
+  0xb8a8d9bbe123f017, 0xb80b0047445d4184,
+  0xe6d3102ad96cec1d, 0xa60dc059157491e5,
+  0x9043ea1ac7e41392, 0x87c89837ad68db2f,
+  0xb454e4a179dd1877, 0x29babe4598c311fb,
+  0xe16a1dc9d8545e94, 0xf4296dd6fef3d67a,
+  0x8ce2529e2734bb1d, 0x1899e4a65f58660c,
+  0xb01ae745b101e9e4, 0x5ec05dcff72e7f8f,
+  0xdc21a1171d42645d, 0x76707543f4fa1f73,
+  0x899504ae72497eba, 0x6a06494a791c53a8,
+  0xabfa45da0edbde69, 0x0487db9d17636892,
+  0xd6f8d7509292d603, 0x45a9d2845d3c42b6,
+  0x865b86925b9bc5c2, 0x0b8a2392ba45a9b2,
+  0xa7f26836f282b732, 0x8e6cac7768d7141e,
+  0xd1ef0244af2364ff, 0x3207d795430cd926,
+  0x8335616aed761f1f, 0x7f44e6bd49e807b8,
+  0xa402b9c5a8d3a6e7, 0x5f16206c9c6209a6,
+  0xcd036837130890a1, 0x36dba887c37a8c0f,
+  0x802221226be55a64, 0xc2494954da2c9789,
+  0xa02aa96b06deb0fd, 0xf2db9baa10b7bd6c,
+  0xc83553c5c8965d3d, 0x6f92829494e5acc7,
+  0xfa42a8b73abbf48c, 0xcb772339ba1f17f9,
+  0x9c69a97284b578d7, 0xff2a760414536efb,
+  0xc38413cf25e2d70d, 0xfef5138519684aba,
+  0xf46518c2ef5b8cd1, 0x7eb258665fc25d69,
+  0x98bf2f79d5993802, 0xef2f773ffbd97a61,
+  0xbeeefb584aff8603, 0xaafb550ffacfd8fa,
+  0xeeaaba2e5dbf6784, 0x95ba2a53f983cf38,
+  0x952ab45cfa97a0b2, 0xdd945a747bf26183,
+  0xba756174393d88df, 0x94f971119aeef9e4,
+  0xe912b9d1478ceb17, 0x7a37cd5601aab85d,
+  0x91abb422ccb812ee, 0xac62e055c10ab33a,
+  0xb616a12b7fe617aa, 0x577b986b314d6009,
+  0xe39c49765fdf9d94, 0xed5a7e85fda0b80b,
+  0x8e41ade9fbebc27d, 0x14588f13be847307,
+  0xb1d219647ae6b31c, 0x596eb2d8ae258fc8,
+  0xde469fbd99a05fe3, 0x6fca5f8ed9aef3bb,
+  0x8aec23d680043bee, 0x25de7bb9480d5854,
+  0xada72ccc20054ae9, 0xaf561aa79a10ae6a,
+  0xd910f7ff28069da4, 0x1b2ba1518094da04,
+  0x87aa9aff79042286, 0x90fb44d2f05d0842,
+  0xa99541bf57452b28, 0x353a1607ac744a53,
+  0xd3fa922f2d1675f2, 0x42889b8997915ce8,
+  0x847c9b5d7c2e09b7, 0x69956135febada11,
+  0xa59bc234db398c25, 0x43fab9837e699095,
+  0xcf02b2c21207ef2e, 0x94f967e45e03f4bb,
+  0x8161afb94b44f57d, 0x1d1be0eebac278f5,
+  0xa1ba1ba79e1632dc, 0x6462d92a69731732,
+  0xca28a291859bbf93, 0x7d7b8f7503cfdcfe,
+  0xfcb2cb35e702af78, 0x5cda735244c3d43e,
+  0x9defbf01b061adab, 0x3a0888136afa64a7,
+  0xc56baec21c7a1916, 0x088aaa1845b8fdd0,
+  0xf6c69a72a3989f5b, 0x8aad549e57273d45,
+  0x9a3c2087a63f6399, 0x36ac54e2f678864b,
+  0xc0cb28a98fcf3c7f, 0x84576a1bb416a7dd,
+  0xf0fdf2d3f3c30b9f, 0x656d44a2a11c51d5,
+  0x969eb7c47859e743, 0x9f644ae5a4b1b325,
+  0xbc4665b596706114, 0x873d5d9f0dde1fee,
+  0xeb57ff22fc0c7959, 0xa90cb506d155a7ea,
+  0x9316ff75dd87cbd8, 0x09a7f12442d588f2,
+  0xb7dcbf5354e9bece, 0x0c11ed6d538aeb2f,
+  0xe5d3ef282a242e81, 0x8f1668c8a86da5fa,
+  0x8fa475791a569d10, 0xf96e017d694487bc,
+  0xb38d92d760ec4455, 0x37c981dcc395a9ac,
+  0xe070f78d3927556a, 0x85bbe253f47b1417,
+  0x8c469ab843b89562, 0x93956d7478ccec8e,
+  0xaf58416654a6babb, 0x387ac8d1970027b2,
+  0xdb2e51bfe9d0696a, 0x06997b05fcc0319e,
+  0x88fcf317f22241e2, 0x441fece3bdf81f03,
+  0xab3c2fddeeaad25a, 0xd527e81cad7626c3,
+  0xd60b3bd56a5586f1, 0x8a71e223d8d3b074,
+  0x85c7056562757456, 0xf6872d5667844e49,
+  0xa738c6bebb12d16c, 0xb428f8ac016561db,
+  0xd106f86e69d785c7, 0xe13336d701beba52,
+  0x82a45b450226b39c, 0xecc0024661173473,
+  0xa34d721642b06084, 0x27f002d7f95d0190,
+  0xcc20ce9bd35c78a5, 0x31ec038df7b441f4,
+  0xff290242c83396ce, 0x7e67047175a15271,
+  0x9f79a169bd203e41, 0x0f0062c6e984d386,
+  0xc75809c42c684dd1, 0x52c07b78a3e60868,
+  0xf92e0c3537826145, 0xa7709a56ccdf8a82,
+  0x9bbcc7a142b17ccb, 0x88a66076400bb691,
+  0xc2abf989935ddbfe, 0x6acff893d00ea435,
+  0xf356f7ebf83552fe, 0x0583f6b8c4124d43,
+  0x98165af37b2153de, 0xc3727a337a8b704a,
+  0xbe1bf1b059e9a8d6, 0x744f18c0592e4c5c,
+  0xeda2ee1c7064130c, 0x1162def06f79df73,
+  0x9485d4d1c63e8be7, 0x8addcb5645ac2ba8,
+  0xb9a74a0637ce2ee1, 0x6d953e2bd7173692,
+  0xe8111c87c5c1ba99, 0xc8fa8db6ccdd0437,
+  0x910ab1d4db9914a0, 0x1d9c9892400a22a2,
+  0xb54d5e4a127f59c8, 0x2503beb6d00cab4b,
+  0xe2a0b5dc971f303a, 0x2e44ae64840fd61d,
+  0x8da471a9de737e24, 0x5ceaecfed289e5d2,
+  0xb10d8e1456105dad, 0x7425a83e872c5f47,
+  0xdd50f1996b947518, 0xd12f124e28f77719,
+  0x8a5296ffe33cc92f, 0x82bd6b70d99aaa6f,
+  0xace73cbfdc0bfb7b, 0x636cc64d1001550b,
+  0xd8210befd30efa5a, 0x3c47f7e05401aa4e,
+  0x8714a775e3e95c78, 0x65acfaec34810a71,
+  0xa8d9d1535ce3b396, 0x7f1839a741a14d0d,
+  0xd31045a8341ca07c, 0x1ede48111209a050,
+  0x83ea2b892091e44d, 0x934aed0aab460432,
+  0xa4e4b66b68b65d60, 0xf81da84d5617853f,
+  0xce1de40642e3f4b9, 0x36251260ab9d668e,
+  0x80d2ae83e9ce78f3, 0xc1d72b7c6b426019,
+  0xa1075a24e4421730, 0xb24cf65b8612f81f,
+  0xc94930ae1d529cfc, 0xdee033f26797b627,
+  0xfb9b7cd9a4a7443c, 0x169840ef017da3b1,
+  0x9d412e0806e88aa5, 0x8e1f289560ee864e,
+  0xc491798a08a2ad4e, 0xf1a6f2bab92a27e2,
+  0xf5b5d7ec8acb58a2, 0xae10af696774b1db,
+  0x9991a6f3d6bf1765, 0xacca6da1e0a8ef29,
+  0xbff610b0cc6edd3f, 0x17fd090a58d32af3,
+  0xeff394dcff8a948e, 0xddfc4b4cef07f5b0,
+  0x95f83d0a1fb69cd9, 0x4abdaf101564f98e,
+  0xbb764c4ca7a4440f, 0x9d6d1ad41abe37f1,
+  0xea53df5fd18d5513, 0x84c86189216dc5ed,
+  0x92746b9be2f8552c, 0x32fd3cf5b4e49bb4,
+  0xb7118682dbb66a77, 0x3fbc8c33221dc2a1,
+  0xe4d5e82392a40515, 0x0fabaf3feaa5334a,
+  0x8f05b1163ba6832d, 0x29cb4d87f2a7400e,
+  0xb2c71d5bca9023f8, 0x743e20e9ef511012,
+  0xdf78e4b2bd342cf6, 0x914da9246b255416,
+  0x8bab8eefb6409c1a, 0x1ad089b6c2f7548e,
+  0xae9672aba3d0c320, 0xa184ac2473b529b1,
+  0xda3c0f568cc4f3e8, 0xc9e5d72d90a2741e,
+  0x8865899617fb1871, 0x7e2fa67c7a658892,
+  0xaa7eebfb9df9de8d, 0xddbb901b98feeab7,
+  0xd51ea6fa85785631, 0x552a74227f3ea565,
+  0x8533285c936b35de, 0xd53a88958f87275f,
+  0xa67ff273b8460356, 0x8a892abaf368f137,
+  0xd01fef10a657842c, 0x2d2b7569b0432d85,
+  0x8213f56a67f6b29b, 0x9c3b29620e29fc73,
+  0xa298f2c501f45f42, 0x8349f3ba91b47b8f,
+  0xcb3f2f7642717713, 0x241c70a936219a73,
+  0xfe0efb53d30dd4d7, 0xed238cd383aa0110,
+  0x9ec95d1463e8a506, 0xf4363804324a40aa,
+  0xc67bb4597ce2ce48, 0xb143c6053edcd0d5,
+  0xf81aa16fdc1b81da, 0xdd94b7868e94050a,
+  0x9b10a4e5e9913128, 0xca7cf2b4191c8326,
+  0xc1d4ce1f63f57d72, 0xfd1c2f611f63a3f0,
+  0xf24a01a73cf2dccf, 0xbc633b39673c8cec,
+  0x976e41088617ca01, 0xd5be0503e085d813,
+  0xbd49d14aa79dbc82, 0x4b2d8644d8a74e18,
+  0xec9c459d51852ba2, 0xddf8e7d60ed1219e,
+  0x93e1ab8252f33b45, 0xcabb90e5c942b503,
+  0xb8da1662e7b00a17, 0x3d6a751f3b936243,
+  0xe7109bfba19c0c9d, 0x0cc512670a783ad4,
+  0x906a617d450187e2, 0x27fb2b80668b24c5,
+  0xb484f9dc9641e9da, 0xb1f9f660802dedf6,
+  0xe1a63853bbd26451, 0x5e7873f8a0396973,
+  0x8d07e33455637eb2, 0xdb0b487b6423e1e8,
+  0xb049dc016abc5e5f, 0x91ce1a9a3d2cda62,
+  0xdc5c5301c56b75f7, 0x7641a140cc7810fb,
+  0x89b9b3e11b6329ba, 0xa9e904c87fcb0a9d,
+  0xac2820d9623bf429, 0x546345fa9fbdcd44,
+  0xd732290fbacaf133, 0xa97c177947ad4095,
+  0x867f59a9d4bed6c0, 0x49ed8eabcccc485d,
+  0xa81f301449ee8c70, 0x5c68f256bfff5a74,
+  0xd226fc195c6a2f8c, 0x73832eec6fff3111,
+  0x83585d8fd9c25db7, 0xc831fd53c5ff7eab,
+  0xa42e74f3d032f525, 0xba3e7ca8b77f5e55,
+  0xcd3a1230c43fb26f, 0x28ce1bd2e55f35eb,
+  0x80444b5e7aa7cf85, 0x7980d163cf5b81b3,
+  0xa0555e361951c366, 0xd7e105bcc332621f,
+  0xc86ab5c39fa63440, 0x8dd9472bf3fefaa7,
+  0xfa856334878fc150, 0xb14f98f6f0feb951,
+  0x9c935e00d4b9d8d2, 0x6ed1bf9a569f33d3,
+  0xc3b8358109e84f07, 0x0a862f80ec4700c8,
+  0xf4a642e14c6262c8, 0xcd27bb612758c0fa,
+  0x98e7e9cccfbd7dbd, 0x8038d51cb897789c,
+  0xbf21e44003acdd2c, 0xe0470a63e6bd56c3,
+  0xeeea5d5004981478, 0x1858ccfce06cac74,
+  0x95527a5202df0ccb, 0x0f37801e0c43ebc8,
+  0xbaa718e68396cffd, 0xd30560258f54e6ba,
+  0xe950df20247c83fd, 0x47c6b82ef32a2069,
+  0x91d28b7416cdd27e, 0x4cdc331d57fa5441,
+  0xb6472e511c81471d, 0xe0133fe4adf8e952,
+  0xe3d8f9e563a198e5, 0x58180fddd97723a6,
+  0x8e679c2f5e44ff8f, 0x570f09eaa7ea7648,
+};
+
+static const double exact_pow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static inline void mul_64x64(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 r = (unsigned __int128)a * b;
+  *hi = (uint64_t)(r >> 64);
+  *lo = (uint64_t)r;
+#else
+  uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+  uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+  uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+  uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+  *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+  *lo = (mid << 32) | (uint32_t)ll;
+#endif
+}
+
+static inline bool is_eight_digits(const char *p) {
+  uint64_t val;
+  memcpy(&val, p, 8);
+  return (((val & 0xF0F0F0F0F0F0F0F0ULL) |
+    (((val + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+    0x3333333333333333ULL);
+}
+
+// SWAR conversion of eight ASCII digits (little-endian load).
+static inline uint64_t parse_eight_digits(const char *p) {
+  uint64_t val;
+  memcpy(&val, p, 8);
+  val -= 0x3030303030303030ULL;
+  val = (val * 10) + (val >> 8);
+  val = (((val & 0x000000FF000000FFULL) * 0x000F424000000064ULL) +
+    (((val >> 16) & 0x000000FF000000FFULL) * 0x0000271000000001ULL)) >> 32;
+  return val;
+}
+
+static const char *parse_digits(const char *p, const char *end, uint64_t *mantissa) {
+  uint64_t m = *mantissa;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (end - p >= 8 && is_eight_digits(p)) {
+    m = m * 100000000 + parse_eight_digits(p);
+    p += 8;
+  }
+#endif
+  for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+    m = m * 10 + (*p - '0');
+  }
+  *mantissa = m;
+  return p;
+}
+
+// Eisel-Lemire: the correctly rounded bits of w * 10^q for a non-zero w, or
+// of zero/infinity outside the representable range.
+static uint64_t eisel_lemire(uint64_t w, int64_t q) {
+  if (w == 0 || q < POW5_MIN_EXP) {
+    return 0;
+  }
+  if (q > POW5_MAX_EXP) {
+    return 0x7FFULL << 52;
+  }
+  int lz = __builtin_clzll(w);
+  w <<= lz;
+  uint64_t index = 2 * (uint64_t)(q - POW5_MIN_EXP);
+  uint64_t hi, lo;
+  mul_64x64(w, pow5_128[index], &hi, &lo);
+  if ((hi & 0x1FF) == 0x1FF) {
+    uint64_t hi2, lo2;
+    mul_64x64(w, pow5_128[index + 1], &hi2, &lo2);
+    lo += hi2;
+    if (hi2 > lo) {
+      ++hi;
+    }
+  }
+  int upperbit = (int)(hi >> 63);
+  int shift = upperbit + 9;
+  uint64_t mantissa = hi >> shift;
+  int64_t power2 = ((((152170 + 65536) * q) >> 16) + 63) + upperbit - lz + 1023;
+  if (power2 <= 0) { // subnormal
+    if (-power2 + 1 >= 64) {
+      return 0;
+    }
+    mantissa >>= -power2 + 1;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    power2 = mantissa < (1ULL << 52) ? 0 : 1;
+    return (mantissa & ((1ULL << 52) - 1)) | ((uint64_t)power2 << 52);
+  }
+  if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1) {
+    if ((mantissa << shift) == hi) { // exactly halfway, round to even
+      mantissa &= ~1ULL;
+    }
+  }
+  mantissa += mantissa & 1;
+  mantissa >>= 1;
+  if (mantissa >= (2ULL << 52)) {
+    mantissa = 1ULL << 52;
+    ++power2;
+  }
+  mantissa &= ~(1ULL << 52);
+  if (power2 >= 0x7FF) {
+    return 0x7FFULL << 52;
+  }
+  return mantissa | ((uint64_t)power2 << 52);
+}
+
+// Exact but slow path for inputs with more than 19 significant digits whose
+// truncation is ambiguous. `exp` applies to all digits read as one integer.
+// The digits are rewritten without a decimal point so strtod does not depend
+// on the locale.
+static double parse_number_fallback(const char *p, const char *p_end, int64_t exp) {
+  char digits[MAX_FALLBACK_DIGITS + 32];
+  uint64_t n = 0;
+  bool sticky = false;
+  for (; p < p_end; ++p) {
+    if (*p == '.' || (n == 0 && *p == '0')) {
+      continue;
+    }
+    if (n < MAX_FALLBACK_DIGITS) {
+      digits[n++] = *p;
+    } else {
+      ++exp;
+      if (*p != '0') {
+        sticky = true;
+      }
+    }
+  }
+  if (n == 0) {
+    return 0;
+  }
+  if (sticky) {
+    digits[n++] = '1';
+    --exp;
+  }
+  if (exp > 100000) {
+    exp = 100000;
+  } else if (exp < -100000) {
+    exp = -100000;
+  }
+  snprintf(digits + n, sizeof(digits) - n, "e%lld", (long long)exp);
+  return strtod(digits, NULL);
+}
+
+static double parse_number_raw(const char **pp, const char *end, bool *ok) {
   const char *p = *pp;
-  double result;
-  int sign = 1;
-  uint64_t intg = 0;
-  double frac = 0;
+  double result = 0;
+  bool negative = false;
+  uint64_t mantissa = 0;
   int64_t exp = 0;
-  if (*p == '-') {
-    sign = -1;
+  int64_t exp_number = 0;
+  if (peek(p, end) == '-') {
+    negative = true;
     ++p; // '-'
   }
-  if (*p < '0' || *p > '9') {
+  if (peek(p, end) < '0' || peek(p, end) > '9') {
     goto label_error;
   }
-  if (*p == '0') {
+  const char *digits_start = p;
+  if (peek(p, end) == '0') {
     ++p; // '0'
   } else { // '1' - '9'
-    for (;*p >= '0' && *p <= '9';) {
-      int x = *p - '0';
-      intg *= 10;
-      intg += x;
-      ++p;
-    }
+    p = parse_digits(p, end, &mantissa);
   }
-  if (*p == '.') {
+  const char *int_end = p;
+  uint64_t digit_count = p - digits_start;
+  const char *frac_start = NULL;
+  if (peek(p, end) == '.') {
     ++p; // '.'
-    if (*p < '0' || *p > '9') {
+    if (peek(p, end) < '0' || peek(p, end) > '9') {
       goto label_error;
     }
-    double frac_intg = 0;
-    uint64_t frac_len = 0;
-    for (;*p >= '0' && *p <= '9';) {
-      int x = *p - '0';
-      frac_intg *= 10;
-      frac_intg += x;
-      ++p;
-      ++frac_len;
-    }
-    frac = frac_intg / pow(10.0, (double)frac_len);
+    frac_start = p;
+    p = parse_digits(p, end, &mantissa);
+    exp = -(int64_t)(p - frac_start);
+    digit_count += p - frac_start;
   }
-  if (*p == 'e' || *p == 'E') {
+  const char *digits_end = p;
+  if (peek(p, end) == 'e' || peek(p, end) == 'E') {
     ++p; // 'e' 'E'
-    int exp_sign = 1;
-    if (*p == '+') {
+    bool exp_negative = false;
+    if (peek(p, end) == '+') {
       ++p; // '+'
-    } else if (*p == '-') {
+    } else if (peek(p, end) == '-') {
       ++p; // '-'
-      exp_sign = -1;
+      exp_negative = true;
     }
-    if (*p < '0' || *p > '9') {
+    if (peek(p, end) < '0' || peek(p, end) > '9') {
       goto label_error;
     }
-    for (;*p >= '0' && *p <= '9';) {
-      int x = *p - '0';
-      exp *= 10;
-      exp += x;
+    for (;peek(p, end) >= '0' && peek(p, end) <= '9';) {
+      if (exp_number < 0x10000000) {
+        exp_number = exp_number * 10 + (*p - '0');
+      }
       ++p;
     }
-    exp *= exp_sign;
+    exp += exp_negative ? -exp_number : exp_number;
   }
-  result = (double)intg + frac;
-  result *= pow(10.0, (double)exp);
-  result *= sign;
   *ok = true;
+  bool truncated = false;
+  int64_t exp_digits = exp;
+  if (digit_count > 19) {
+    const char *q = digits_start;
+    for (; q < digits_end && (*q == '0' || *q == '.'); ++q) {
+      if (*q == '0') {
+        --digit_count;
+      }
+    }
+    if (digit_count > 19) { // keep the first 19 significant digits
+      truncated = true;
+      mantissa = 0;
+      for (q = digits_start; mantissa < 1000000000000000000ULL && q < int_end; ++q) {
+        mantissa = mantissa * 10 + (*q - '0');
+      }
+      if (mantissa >= 1000000000000000000ULL) {
+        exp = exp_digits + (frac_start != NULL ? digits_end - frac_start : 0) + (int_end - q);
+      } else {
+        for (q = frac_start; mantissa < 1000000000000000000ULL && q < digits_end; ++q) {
+          mantissa = mantissa * 10 + (*q - '0');
+        }
+        exp = exp_digits + (digits_end - frac_start) - (q - frac_start);
+      }
+    }
+  }
+  uint64_t bits;
+  if (!truncated && exp == 0) { // integer
+    result = (double)mantissa;
+    goto label_sign;
+  }
+  if (!truncated && exp >= -22 && exp <= 22 && mantissa <= (1ULL << 53)) { // exact operands
+    result = (double)mantissa;
+    if (exp < 0) {
+      result /= exact_pow10[-exp];
+    } else {
+      result *= exact_pow10[exp];
+    }
+    goto label_sign;
+  }
+  bits = eisel_lemire(mantissa, exp);
+  if (truncated && bits != eisel_lemire(mantissa + 1, exp)) {
+    result = parse_number_fallback(digits_start, digits_end, exp_digits);
+    goto label_sign;
+  }
+  memcpy(&result, &bits, sizeof(result));
+label_sign:
+  if (negative) {
+    result = -result;
+  }
   goto label_return;
 label_error:
   *ok = false;
@@ -140,55 +1533,175 @@ label_return:
   return result;
 }
 
-static cj_string *parse_string_raw(const char **pp) {
+// Length of the prefix of [p, end) that contains no '"', '\\' or control
+// character, i.e. the bytes a string can take over without decoding.
+static uint64_t scan_string_run(const char *p, const char *end) {
+  const char *start = p;
+#if defined(__AVX2__)
+  const __m256i quote32 = _mm256_set1_epi8('"');
+  const __m256i backslash32 = _mm256_set1_epi8('\\');
+  const __m256i control32 = _mm256_set1_epi8((char)0xE0);
+  const __m256i zero32 = _mm256_setzero_si256();
+  while (end - p >= 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)p);
+    __m256i special = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(block, quote32), _mm256_cmpeq_epi8(block, backslash32)),
+      _mm256_cmpeq_epi8(_mm256_and_si256(block, control32), zero32)
+    );
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+    if (mask != 0) {
+      return (uint64_t)(p - start) + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8((char)0xE0);
+  const __m128i zero = _mm_setzero_si128();
+  while (end - p >= 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    __m128i special = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+      _mm_cmpeq_epi8(_mm_and_si128(block, control), zero)
+    );
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(special);
+    if (mask != 0) {
+      return (uint64_t)(p - start) + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+#endif
+  for (; p < end; ++p) {
+    uint8_t c = *p;
+    if (c == '"' || c == '\\' || c <= 0x1F) {
+      break;
+    }
+  }
+  return (uint64_t)(p - start);
+}
+
+// Checks that [p, p + len) is well formed UTF-8 (lead and continuation
+// bytes only, like the per-character decoder). ASCII is skipped a block at a
+// time. Returns NULL on success or the first offending byte.
+static const char *validate_utf8(const char *p, uint64_t len) {
+  const char *end = p + len;
+  while (p < end) {
+    uint8_t code = *p;
+    int n;
+    if (code <= 0x7F) {
+#if defined(__SSE2__)
+      if (end - p >= 16) {
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p));
+        p += mask != 0 ? __builtin_ctz(mask) : 16;
+        continue;
+      }
+#else
+      if (end - p >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        if ((word & 0x8080808080808080ULL) == 0) {
+          p += 8;
+          continue;
+        }
+      }
+#endif
+      ++p;
+      continue;
+    } else if ((code & 0xE0) == 0xC0) { // 110xxxxx
+      n = 1;
+    } else if ((code & 0xF0) == 0xE0) { // 1110xxxx
+      n = 2;
+    } else if ((code & 0xF8) == 0xF0) { // 11110xxx
+      n = 3;
+    } else {
+      return p;
+    }
+    ++p;
+    for (int i = 0; i < n; ++i) {
+      if (p == end || (*p & 0xC0) != 0x80) { // 10xxxxxx
+        return p;
+      }
+      ++p;
+    }
+  }
+  return NULL;
+}
+
+// Decodes the string token at *pp into ctx->scratch, or over the token
+// itself (ctx->view) in in-situ mode: the decoded text is never longer than
+// the escapes it comes from, so it always fits.
+static bool decode_string(const char **pp, context *ctx) {
   const char *p = *pp;
-  cj_string *result = NULL;
-  buffer buf;
-  buffer_init(&buf);
-  if (*p != '"') {
+  bool result = true;
+  const char *end = ctx->end;
+  buffer *buf = &ctx->scratch;
+  buf->len = 0;
+  if (peek(p, end) != '"') {
     goto label_error;
   }
   ++p; // '"'
+  if (ctx->insitu) {
+    buf = &ctx->view;
+    buf->data = (char *)p;
+    buf->cap = (uint64_t)(end - p);
+    buf->len = 0;
+  }
   for (;;) {
-    if (*p == '"') {
+    const char *run = p;
+    p += scan_string_run(p, end);
+    if (p != run) { // unescaped
+      const char *bad = validate_utf8(run, p - run);
+      if (bad != NULL) {
+        p = bad;
+        goto label_error;
+      }
+      if (buf->data + buf->len == run) { // in-situ and nothing unescaped yet
+        buf->len += p - run;
+      } else {
+        buffer_write_string(buf, run, p - run);
+      }
+    }
+    if (peek(p, end) == '"') {
       break;
     }
-    if (*p >= 0 && *p <= 0x1F) {
+    if (peek(p, end) >= 0 && peek(p, end) <= 0x1F) {
       goto label_error;
-    } else if (*p == '\\') { // escape
+    } else if (peek(p, end) == '\\') { // escape
       ++p; // '\'
       if (
-        *p == '"' ||
-        *p == '\\' ||
-        *p == '/'
+        peek(p, end) == '"' ||
+        peek(p, end) == '\\' ||
+        peek(p, end) == '/'
       ) {
-        buffer_write_byte(&buf, *p);
+        buffer_write_byte(buf, *p);
         ++p; // '"'   '\'   '/'
-      } else if (*p == 'b') {
-        buffer_write_byte(&buf, '\b');
+      } else if (peek(p, end) == 'b') {
+        buffer_write_byte(buf, '\b');
         ++p; // 'b'
-      } else if (*p == 'f') {
-        buffer_write_byte(&buf, '\f');
+      } else if (peek(p, end) == 'f') {
+        buffer_write_byte(buf, '\f');
         ++p; // 'f'
-      } else if (*p == 'n') {
-        buffer_write_byte(&buf, '\n');
+      } else if (peek(p, end) == 'n') {
+        buffer_write_byte(buf, '\n');
         ++p; // 'n'
-      } else if (*p == 'r') {
-        buffer_write_byte(&buf, '\r');
+      } else if (peek(p, end) == 'r') {
+        buffer_write_byte(buf, '\r');
         ++p; // 'r'
-      } else if (*p == 't') {
-        buffer_write_byte(&buf, '\t');
+      } else if (peek(p, end) == 't') {
+        buffer_write_byte(buf, '\t');
         ++p; // 't'
-      } else if (*p == 'u') {
+      } else if (peek(p, end) == 'u') {
         ++p; // 'u'
         uint16_t code = 0;
         for (int i = 0; i < 4; ++i) {
           uint8_t val;
-          if (*p >= '0' && *p <= '9') {
+          if (peek(p, end) >= '0' && peek(p, end) <= '9') {
             val = *p - '0';
-          } else if (*p >= 'a' && *p <= 'f') {
+          } else if (peek(p, end) >= 'a' && peek(p, end) <= 'f') {
             val = *p - 'a' + 10;
-          } else if (*p >= 'A' && *p <= 'F') {
+          } else if (peek(p, end) >= 'A' && peek(p, end) <= 'F') {
             val = *p - 'A' + 10;
           } else {
             goto label_error;
@@ -199,6 +1712,7 @@ static cj_string *parse_string_raw(const char **pp) {
         if (
           code >= 0xD800 &&
           code <= 0xDBFF &&
+          end - p >= 6 &&
           p[0] == '\\' &&
           p[1] == 'u' &&
           isxdigit(p[2]) &&
@@ -225,445 +1739,3850 @@ static cj_string *parse_string_raw(const char **pp) {
             goto label_unicode_continue;
           }
           uint32_t full_code = 0x10000 + ((code - 0xD800) << 10) + (low_code - 0xDC00);
-          buffer_write_byte(&buf, 0xF0 | ((full_code >> 18) & 0x07)); // 11110xxx
-          buffer_write_byte(&buf, 0x80 | ((full_code >> 12) & 0x3F)); // 10xxxxxx
-          buffer_write_byte(&buf, 0x80 | ((full_code >> 6) & 0x3F)); // 10xxxxxx
-          buffer_write_byte(&buf, 0x80 | (full_code & 0x3F)); // 10xxxxxx
+          buffer_write_byte(buf, 0xF0 | ((full_code >> 18) & 0x07)); // 11110xxx
+          buffer_write_byte(buf, 0x80 | ((full_code >> 12) & 0x3F)); // 10xxxxxx
+          buffer_write_byte(buf, 0x80 | ((full_code >> 6) & 0x3F)); // 10xxxxxx
+          buffer_write_byte(buf, 0x80 | (full_code & 0x3F)); // 10xxxxxx
           p += 6;
           continue;
         }
 label_unicode_continue:
         if (code <= 0x7F) {
-          buffer_write_byte(&buf, code); // 0xxxxxxx
+          buffer_write_byte(buf, code); // 0xxxxxxx
         } else if (code <= 0x7FF) {
-          buffer_write_byte(&buf, 0xC0 | (code >> 6)); // 110xxxxx
-          buffer_write_byte(&buf, 0x80 | (code & 0x3F)); // 10xxxxxx
+          buffer_write_byte(buf, 0xC0 | (code >> 6)); // 110xxxxx
+          buffer_write_byte(buf, 0x80 | (code & 0x3F)); // 10xxxxxx
         } else { // <= FFFF
-          buffer_write_byte(&buf, 0xE0 | (code >> 12)); // 1110xxxx
-          buffer_write_byte(&buf, 0x80 | ((code >> 6) & 0x3F)); // 10xxxxxx
-          buffer_write_byte(&buf, 0x80 | (code & 0x3F)); // 10xxxxxx
-        }
-      } else {
-        goto label_error;
-      }
-    } else { // unescaped
-      uint8_t code = *p;
-      if (code <= 0x7F) {
-        buffer_write_byte(&buf, code); // 0xxxxxxx
-        ++p;
-      } else if ((code & 0xE0) == 0xC0) {
-        buffer_write_byte(&buf, code); // 110xxxxx
-        ++p;
-        code = *p;
-        if ((code & 0xC0) != 0x80) {
-          goto label_error;
-        }
-        buffer_write_byte(&buf, code); // 10xxxxxx
-        ++p;
-      } else if ((code & 0xF0) == 0xE0) {
-        buffer_write_byte(&buf, code); // 1110xxxx
-        ++p;
-        for (int i = 0; i < 2; ++i) {
-          code = *p;
-          if ((code & 0xC0) != 0x80) {
-            goto label_error;
-          }
-          buffer_write_byte(&buf, code); // 10xxxxxx
-          ++p;
-        }
-      } else if ((code & 0xF8) == 0xF0) {
-        buffer_write_byte(&buf, code); // 11110xxx
-        ++p;
-        for (int i = 0; i < 3; ++i) {
-          code = *p;
-          if ((code & 0xC0) != 0x80) {
-            goto label_error;
-          }
-          buffer_write_byte(&buf, code); // 10xxxxxx
-          ++p;
+          buffer_write_byte(buf, 0xE0 | (code >> 12)); // 1110xxxx
+          buffer_write_byte(buf, 0x80 | ((code >> 6) & 0x3F)); // 10xxxxxx
+          buffer_write_byte(buf, 0x80 | (code & 0x3F)); // 10xxxxxx
         }
       } else {
         goto label_error;
       }
     }
   }
-  if (*p != '"') {
+  if (peek(p, end) != '"') {
     goto label_error;
   }
   ++p; // '"'
-  result = cj_malloc(sizeof(cj_string) + buf.len + 1);
-  result->len = buf.len;
-  memcpy(result->data, buf.data, buf.len);
-  result->data[buf.len] = '\0';
   goto label_return;
 label_error:
-  result = NULL;
+  result = false;
 label_return:
-  buffer_clean(&buf);
   *pp = p;
   return result;
 }
 
-static cj_value *parse_object(const char **pp) {
-  const char *p = *pp;
-  cj_value *result = NULL;
-  if (*p != '{') {
-    goto label_error;
+// The string decode_string left in the context, as a cj_string: in situ it
+// is terminated in place, otherwise copied out of the scratch buffer.
+static cj_string *context_string(context *ctx) {
+  if (ctx->insitu) {
+    buffer *view = &ctx->view;
+    cj_string *result = arena_alloc(ctx->arena, sizeof(cj_string));
+    result->len = view->len;
+    result->data = view->data;
+    result->data[view->len] = '\0'; // at most the closing quote
+    return result;
   }
-  ++p; // '{'
-  result = create_cj_value(CJ_TYPE_OBJECT);
-  cj_value *prev = NULL;
-  skip_whitespace(&p); // ws
-  if (*p == '}') {
-    ++p; // '}'
-    goto label_return;
+  buffer *buf = &ctx->scratch;
+  cj_string *result = context_alloc(ctx, sizeof(cj_string) + buf->len + 1);
+  result->len = buf->len;
+  result->data = (char *)(result + 1);
+  memcpy(result->data, buf->data, buf->len);
+  result->data[buf->len] = '\0';
+  return result;
+}
+
+static cj_string *parse_string_raw(const char **pp, context *ctx) {
+  if (!decode_string(pp, ctx)) {
+    return NULL;
   }
-  for (;;) {
-    cj_string *name = parse_string_raw(&p); // string
-    if (name == NULL) {
-      goto label_error;
-    }
-    skip_whitespace(&p); // ws
-    if (*p != ':') {
-      cj_free(name);
-      goto label_error;
-    }
-    ++p; // ':'
-    skip_whitespace(&p); // ws
-    cj_value *member = parse_value(&p); // value
-    if (member == NULL) {
-      cj_free(name);
+  return context_string(ctx);
+}
+
+static bool check_literal(const char **pp, const char *end, const char *pattern, uint64_t len) {
+  const char *p = *pp;
+  bool result = true;
+  for (uint64_t i = 0; i < len; ++i) {
+    if (peek(p, end) != pattern[i]) {
       goto label_error;
     }
-    member->name = name;
-    if (prev != NULL) {
-      prev->next = member;
-    } else {
-      result->value.members = member;
-    }
-    prev = member;
-    skip_whitespace(&p); // ws
-    if (*p != ',') {
-      break;
-    }
-    ++p; // ','
-    skip_whitespace(&p); // ws
-  }
-  if (*p != '}') {
-    goto label_error;
+    ++p;
   }
-  ++p; // '}'
   goto label_return;
 label_error:
-  cj_clean(result);
-  result = NULL;
+  result = false;
 label_return:
   *pp = p;
   return result;
 }
 
-static cj_value *parse_array(const char **pp) {
-  const char *p = *pp;
-  cj_value *result = NULL;
-  if (*p != '[') {
-    goto label_error;
+// What reader_next read. A name has been decoded like a string and its ':'
+// consumed; END follows the close of the outermost value.
+#define EVENT_ERROR      0
+#define EVENT_OBJECT     1
+#define EVENT_ARRAY      2
+#define EVENT_OBJECT_END 3
+#define EVENT_ARRAY_END  4
+#define EVENT_NAME       5
+#define EVENT_STRING     6
+#define EVENT_NUMBER     7
+#define EVENT_TRUE       8
+#define EVENT_FALSE      9
+#define EVENT_NULL       10
+#define EVENT_END        11
+
+#define READER_VALUE 0
+#define READER_NAME  1
+#define READER_NEXT  2
+#define READER_CLOSE 3
+
+typedef struct reader reader;
+
+// The value grammar as a pull tokenizer, shared by parse_value and
+// cj_sax_parse. Open containers are one bit each (set for objects); strings
+// and names are decoded into the context, numbers into `number`.
+struct reader {
+  const char *p;
+  context *ctx;
+  uint64_t depth;
+  int state;
+  double number;
+  uint8_t objects[CJ_MAX_DEPTH / 8 + 1];
+};
+
+static void reader_init(reader *r, const char *p, context *ctx) {
+  r->p = p;
+  r->ctx = ctx;
+  r->depth = 0;
+  r->state = READER_VALUE;
+}
+
+// Called once per token by both parsers; out of line it costs parse_value
+// a call and a reload of the reader on every one.
+#if defined(__GNUC__)
+#define READER_INLINE __attribute__((always_inline)) static inline
+#else
+#define READER_INLINE static inline
+#endif
+
+READER_INLINE int reader_next(reader *r) {
+  const char *p = r->p;
+  const char *end = r->ctx->end;
+  int event;
+  bool object;
+  char c;
+  if (r->state == READER_NEXT) {
+    goto label_next;
   }
-  ++p; // '['
-  result = create_cj_value(CJ_TYPE_ARRAY);
-  cj_value *prev = NULL;
-  skip_whitespace(&p); // ws
-  if (*p == ']') {
-    ++p; // ']'
-    goto label_return;
+  if (r->state == READER_NAME) {
+    goto label_name;
   }
-  for (;;) {
-    cj_value *element = parse_value(&p); // value
-    if (element == NULL) {
+  if (r->state == READER_CLOSE) {
+    goto label_close;
+  }
+label_value:
+  c = peek(p, end);
+  if (c == '{' || c == '[') {
+    ++p; // '{' '['
+    if (r->ctx->depth + r->depth == CJ_MAX_DEPTH) {
       goto label_error;
     }
-    if (prev != NULL) {
-      prev->next = element;
+    if (c == '{') {
+      r->objects[r->depth >> 3] |= 1 << (r->depth & 7);
     } else {
-      result->value.elements = element;
+      r->objects[r->depth >> 3] &= ~(1 << (r->depth & 7));
     }
-    prev = element;
-    skip_whitespace(&p); // ws
-    if (*p != ',') {
-      break;
+    ++r->depth;
+    skip_whitespace(&p, end); // ws
+    if (peek(p, end) == (c == '{' ? '}' : ']')) {
+      r->state = READER_CLOSE;
+    } else {
+      r->state = c == '{' ? READER_NAME : READER_VALUE;
     }
-    ++p; // ','
-    skip_whitespace(&p); // ws
+    event = c == '{' ? EVENT_OBJECT : EVENT_ARRAY;
+    goto label_return;
   }
-  if (*p != ']') {
+  if (c == '"') {
+    if (!decode_string(&p, r->ctx)) {
+      goto label_error;
+    }
+    event = EVENT_STRING;
+  } else if ((c >= '0' && c <= '9') || c == '-') {
+    bool ok;
+    r->number = parse_number_raw(&p, end, &ok);
+    if (!ok) {
+      goto label_error;
+    }
+    event = EVENT_NUMBER;
+  } else if (c == 't' && check_literal(&p, end, "true", 4)) {
+    event = EVENT_TRUE;
+  } else if (c == 'f' && check_literal(&p, end, "false", 5)) {
+    event = EVENT_FALSE;
+  } else if (c == 'n' && check_literal(&p, end, "null", 4)) {
+    event = EVENT_NULL;
+  } else {
     goto label_error;
   }
-  ++p; // ']'
+  r->state = READER_NEXT;
   goto label_return;
-label_error:
-  cj_clean(result);
-  result = NULL;
-label_return:
-  *pp = p;
-  return result;
-}
-
-static cj_value *parse_number(const char **pp) {
-  const char *p = *pp;
-  cj_value *result = NULL;
-  bool ok;
-  double raw = parse_number_raw(&p, &ok);
-  if (!ok) {
+label_next:
+  if (r->depth == 0) {
+    event = EVENT_END;
+    goto label_return;
+  }
+  skip_whitespace(&p, end); // ws
+  object = r->objects[(r->depth - 1) >> 3] & (1 << ((r->depth - 1) & 7));
+  if (peek(p, end) == ',') {
+    ++p; // ','
+    skip_whitespace(&p, end); // ws
+    if (object) {
+      goto label_name;
+    }
+    goto label_value;
+  }
+  if (peek(p, end) != (object ? '}' : ']')) {
     goto label_error;
   }
-  result = create_cj_value(CJ_TYPE_NUMBER);
-  result->value.number = raw;
+label_close:
+  ++p; // '}' ']'
+  --r->depth;
+  object = r->objects[r->depth >> 3] & (1 << (r->depth & 7));
+  event = object ? EVENT_OBJECT_END : EVENT_ARRAY_END;
+  r->state = READER_NEXT;
   goto label_return;
-label_error:
-  result = NULL;
-label_return:
-  *pp = p;
-  return result;
-}
-
-static cj_value *parse_string(const char **pp) {
-  const char *p = *pp;
-  cj_value *result = NULL;
-  cj_string *raw = parse_string_raw(&p);
-  if (raw == NULL) {
+label_name:
+  if (!decode_string(&p, r->ctx)) { // string
     goto label_error;
   }
-  result = create_cj_value(CJ_TYPE_STRING);
-  result->value.string = raw;
+  skip_whitespace(&p, end); // ws
+  if (peek(p, end) != ':') {
+    goto label_error;
+  }
+  ++p; // ':'
+  skip_whitespace(&p, end); // ws
+  event = EVENT_NAME;
+  r->state = READER_VALUE;
   goto label_return;
 label_error:
-  result = NULL;
+  event = EVENT_ERROR;
 label_return:
-  *pp = p;
-  return result;
+  r->p = p;
+  return event;
 }
 
-static bool check_literal(const char **pp, const char *pattern, uint64_t len) {
-  const char *p = *pp;
-  bool result = true;
-  for (uint64_t i = 0; i < len; ++i) {
-    if (*p != pattern[i]) {
+// Iterative: open containers are kept on an explicit stack rather than the
+// C stack, so deep input fails cleanly at CJ_MAX_DEPTH.
+static cj_value *parse_value(const char **pp, context *ctx) {
+  reader r;
+  reader_init(&r, *pp, ctx);
+  cj_value *root = NULL;
+  cj_value *value;
+  cj_string *name = NULL;
+  parse_frame *stack = NULL;
+  uint64_t depth = 0;
+  uint64_t cap = 0;
+  for (;;) {
+    int event = reader_next(&r);
+    if (event == EVENT_OBJECT) {
+      value = create_cj_value(ctx, CJ_TYPE_OBJECT);
+    } else if (event == EVENT_ARRAY) {
+      value = create_cj_value(ctx, CJ_TYPE_ARRAY);
+    } else if (event == EVENT_STRING) {
+      value = create_cj_value(ctx, CJ_TYPE_STRING);
+      value->value.string = context_string(ctx);
+    } else if (event == EVENT_NUMBER) {
+      value = create_cj_value(ctx, CJ_TYPE_NUMBER);
+      value->value.number = r.number;
+    } else if (event == EVENT_TRUE) {
+      value = create_cj_value(ctx, CJ_TYPE_TRUE);
+    } else if (event == EVENT_FALSE) {
+      value = create_cj_value(ctx, CJ_TYPE_FALSE);
+    } else if (event == EVENT_NULL) {
+      value = create_cj_value(ctx, CJ_TYPE_NULL);
+    } else if (event == EVENT_NAME) {
+      if (ctx->intern != NULL) {
+        name = &intern_lookup(ctx->intern, ctx->scratch.data, ctx->scratch.len, true)->string;
+      } else {
+        name = context_string(ctx);
+      }
+      continue;
+    } else if (event == EVENT_OBJECT_END || event == EVENT_ARRAY_END) {
+      --depth;
+      parse_frame_close(&stack[depth], ctx);
+      continue;
+    } else if (event == EVENT_END) {
+      goto label_return;
+    } else {
+      goto label_error;
+    }
+    if (depth == 0) {
+      root = value;
+    } else {
+      value->name = name;
+      name = NULL;
+      parse_frame_append(&stack[depth - 1], value);
+    }
+    if ((event == EVENT_OBJECT || event == EVENT_ARRAY) && !parse_frame_push(&stack, &depth, &cap, value, ctx->allocator)) {
       goto label_error;
     }
-    ++p;
   }
-  goto label_return;
 label_error:
-  result = false;
+  context_free_string(ctx, name);
+  context_free_value(ctx, root);
+  root = NULL;
 label_return:
-  *pp = p;
-  return result;
+  allocator_free(ctx->allocator, stack, cap * sizeof(parse_frame));
+  *pp = r.p;
+  return root;
 }
 
-static cj_value *parse_true(const char **pp) {
-  const char *p = *pp;
-  cj_value *result = NULL;
-  bool ok = check_literal(&p, "true", 4);
-  if (!ok) {
+static cj_value *parse_text(const char *text, uint64_t len, char **end, context *ctx) {
+  const char *p = text;
+  ctx->end = text + len;
+  skip_whitespace(&p, ctx->end); // ws
+  cj_value *value = parse_value(&p, ctx); // value
+  if (value == NULL) {
+    goto label_error;
+  }
+  skip_whitespace(&p, ctx->end); // ws
+  if (p != ctx->end) {
     goto label_error;
   }
-  result = create_cj_value(CJ_TYPE_TRUE);
   goto label_return;
 label_error:
-  result = NULL;
+  context_free_value(ctx, value);
+  value = NULL;
 label_return:
-  *pp = p;
-  return result;
+  if (end != NULL) {
+    *end = (char *)p;
+  }
+  return value;
 }
 
-static cj_value *parse_false(const char **pp) {
-  const char *p = *pp;
-  cj_value *result = NULL;
-  bool ok = check_literal(&p, "false", 5);
-  if (!ok) {
-    goto label_error;
+cj_value *cj_parse(const char *text, char **end) {
+  return cj_parse_n(text, strlen(text), end);
+}
+
+cj_value *cj_parse_n(const char *text, uint64_t len, char **end) {
+  return cj_parse_with(text, len, end, NULL);
+}
+
+cj_value *cj_parse_with(const char *text, uint64_t len, char **end, const cj_allocator *allocator) {
+  context ctx;
+  context_init(&ctx, NULL, allocator);
+  cj_value *value = parse_text(text, len, end, &ctx);
+  context_clean(&ctx);
+  return value;
+}
+
+struct cj_doc {
+  arena arena;
+  cj_value *root;
+};
+
+cj_doc *cj_doc_parse(const char *text, char **end) {
+  return cj_doc_parse_n(text, strlen(text), end);
+}
+
+cj_doc *cj_doc_parse_n(const char *text, uint64_t len, char **end) {
+  return cj_doc_parse_with(text, len, end, NULL);
+}
+
+cj_doc *cj_doc_parse_with(const char *text, uint64_t len, char **end, const cj_allocator *allocator) {
+  cj_doc *doc = allocator_alloc(allocator, sizeof(cj_doc));
+  arena_init(&doc->arena, allocator);
+  context ctx;
+  context_init(&ctx, &doc->arena, allocator);
+  doc->root = parse_text(text, len, end, &ctx);
+  context_clean(&ctx);
+  if (doc->root == NULL) {
+    cj_doc_clean(doc);
+    doc = NULL;
   }
-  result = create_cj_value(CJ_TYPE_FALSE);
-  goto label_return;
-label_error:
-  result = NULL;
-label_return:
-  *pp = p;
-  return result;
+  return doc;
 }
 
-static cj_value *parse_null(const char **pp) {
-  const char *p = *pp;
-  cj_value *result = NULL;
-  bool ok = check_literal(&p, "null", 4);
-  if (!ok) {
-    goto label_error;
+cj_doc *cj_parse_insitu(char *text, uint64_t len, char **end) {
+  cj_doc *doc = cj_malloc(sizeof(cj_doc));
+  arena_init(&doc->arena, NULL);
+  context ctx;
+  context_init(&ctx, &doc->arena, NULL);
+  ctx.insitu = true;
+  doc->root = parse_text(text, len, end, &ctx);
+  context_clean(&ctx);
+  if (doc->root == NULL) {
+    cj_doc_clean(doc);
+    doc = NULL;
   }
-  result = create_cj_value(CJ_TYPE_NULL);
-  goto label_return;
-label_error:
-  result = NULL;
-label_return:
-  *pp = p;
-  return result;
+  return doc;
 }
 
-static cj_value *parse_value(const char **pp) {
-  const char *p = *pp;
-  cj_value *value = NULL;
-  if (*p == '{') {
-    value = parse_object(&p);
-  } else if (*p == '[') {
-    value = parse_array(&p);
-  } else if (*p == '"') {
-    value = parse_string(&p);
-  } else if (*p == 't') {
-    value = parse_true(&p);
-  } else if (*p == 'f') {
-    value = parse_false(&p);
-  } else if (*p == 'n') {
-    value = parse_null(&p);
-  } else if ((*p >= '0' && *p <= '9') || *p == '-') {
-    value = parse_number(&p);
+typedef struct file_view file_view;
+
+struct file_view {
+  const char *data;
+  uint64_t len;
+  bool mapped;
+};
+
+// Maps the file read-only with sequential read-ahead, or reads it into
+// memory where mmap is not available.
+static bool file_view_open(file_view *view, const char *path) {
+  view->data = NULL;
+  view->len = 0;
+  view->mapped = false;
+#if defined(USE_MMAP)
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
   }
-  *pp = p;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  view->len = (uint64_t)st.st_size;
+  if (view->len > 0) {
+    void *data = mmap(NULL, view->len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    posix_madvise(data, view->len, POSIX_MADV_SEQUENTIAL);
+    posix_madvise(data, view->len, POSIX_MADV_WILLNEED);
+    view->data = data;
+    view->mapped = true;
+  }
+  close(fd);
+  return true;
+#else
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  buffer buf;
+  buffer_init(&buf, NULL);
+  for (;;) {
+    char *out = buffer_reserve(&buf, 1 << 16);
+    size_t n = fread(out, 1, 1 << 16, file);
+    buf.len += n;
+    if (n == 0) {
+      break;
+    }
+  }
+  bool ok = !ferror(file);
+  fclose(file);
+  view->data = buf.data;
+  view->len = buf.len;
+  return ok;
+#endif
+}
+
+static void file_view_close(file_view *view) {
+#if defined(USE_MMAP)
+  if (view->mapped) {
+    munmap((void *)view->data, view->len);
+  }
+#else
+  cj_free((void *)view->data);
+#endif
+}
+
+cj_value *cj_parse_file(const char *path) {
+  file_view view;
+  if (!file_view_open(&view, path)) {
+    return NULL;
+  }
+  cj_value *value = cj_parse_n(view.data, view.len, NULL);
+  file_view_close(&view);
   return value;
 }
 
-cj_value *cj_parse(const char *text, char **end) {
-  const char *p = text;
-  skip_whitespace(&p); // ws
-  cj_value *value = parse_value(&p); // value
-  if (value == NULL) {
-    goto label_error;
+cj_doc *cj_doc_parse_file(const char *path) {
+  file_view view;
+  if (!file_view_open(&view, path)) {
+    return NULL;
   }
-  skip_whitespace(&p); // ws
-  if (*p != '\0') {
-    goto label_error;
+  cj_doc *doc = cj_doc_parse_n(view.data, view.len, NULL);
+  file_view_close(&view);
+  return doc;
+}
+
+cj_doc *cj_doc_parse_interned(const char *text, uint64_t len, char **end, cj_intern *table) {
+  cj_doc *doc = cj_malloc(sizeof(cj_doc));
+  arena_init(&doc->arena, NULL);
+  cj_intern own;
+  if (table == NULL) {
+    intern_init(&own, &doc->arena);
   }
-  goto label_return;
-label_error:
-  cj_clean(value);
-  value = NULL;
-label_return:
-  if (end != NULL) {
-    *end = (char *)p;
+  context ctx;
+  context_init(&ctx, &doc->arena, NULL);
+  ctx.intern = table != NULL ? table : &own;
+  doc->root = parse_text(text, len, end, &ctx);
+  context_clean(&ctx);
+  if (table == NULL) {
+    intern_clean(&own);
   }
-  return value;
+  if (doc->root == NULL) {
+    cj_doc_clean(doc);
+    doc = NULL;
+  }
+  return doc;
 }
 
-void cj_clean(cj_value *value) {
-  if (value == NULL) {
+cj_value *cj_doc_root(cj_doc *doc) {
+  return doc->root;
+}
+
+void cj_doc_clean(cj_doc *doc) {
+  if (doc == NULL) {
     return;
   }
-  cj_value *next = NULL;
-  cj_value *p = value;
-  for (; p != NULL; p = next) {
-    next = p->next;
-    if (p->name != NULL) {
-      cj_free(p->name);
-    }
-    if (p->type == CJ_TYPE_OBJECT) {
-      cj_clean(p->value.members);
-    } else if (p->type == CJ_TYPE_ARRAY) {
-      cj_clean(p->value.elements);
-    } else if (p->type == CJ_TYPE_STRING) {
-      cj_free(p->value.string);
-    }
-    cj_free(p);
+  const cj_allocator *allocator = doc->arena.allocator;
+  arena_clean(&doc->arena);
+  allocator_free(allocator, doc, sizeof(cj_doc));
+}
+
+#define POOL_GRANULE 16
+#define POOL_CLASSES 16 // blocks of up to POOL_CLASSES * POOL_GRANULE bytes
+#define POOL_BATCH 64
+
+typedef struct pool_block pool_block;
+
+// A free block. The first block of a batch on the shared lists also links
+// to the next batch.
+struct pool_block {
+  pool_block *next;
+  pool_block *next_batch;
+};
+
+typedef struct pool_slab pool_slab;
+
+// The memory one batch is carved from, in a single allocation. Blocks go
+// back to the pool, never to the system, so slabs are kept until
+// cj_pool_trim. Two words keep the blocks after it 16-byte aligned.
+struct pool_slab {
+  pool_slab *next;
+  uint64_t size;
+};
+
+typedef struct pool_cache pool_cache;
+
+// Free blocks of each size class kept by one thread: up to a batch in
+// `blocks`, and one full batch in `spare`. When `blocks` fills up it becomes
+// the spare, the old spare going to the shared lists; when it runs out, the
+// spare or a shared batch takes its place. Both are pointer swaps, so no
+// thread holds more than two batches of a class and blocks freed by one
+// thread are reused by the others. A cache filled before the last
+// cj_pool_trim points into freed slabs; its `generation` tells it apart, so
+// that it is dropped rather than used or flushed.
+struct pool_cache {
+  pool_block *blocks[POOL_CLASSES];
+  pool_block *spare[POOL_CLASSES];
+  uint64_t count[POOL_CLASSES]; // in `blocks`
+  uint64_t generation;
+  bool registered;
+};
+
+// Full batches, the blocks of exited threads that do not make up one yet,
+// and every slab, all under pool_lock.
+static pool_block *pool_batches[POOL_CLASSES];
+static pool_block *pool_loose[POOL_CLASSES];
+static uint64_t pool_loose_count[POOL_CLASSES];
+static pool_slab *pool_slabs;
+static uint64_t pool_generation; // bumped by cj_pool_trim
+
+#if defined(USE_THREADS)
+static _Thread_local pool_cache pool_local;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t pool_key;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+#define POOL_LOCK() pthread_mutex_lock(&pool_lock)
+#define POOL_UNLOCK() pthread_mutex_unlock(&pool_lock)
+#else
+static pool_cache pool_local;
+#define POOL_LOCK() ((void)0)
+#define POOL_UNLOCK() ((void)0)
+#endif
+
+static uint64_t pool_generation_get(void) {
+#if defined(__GNUC__)
+  return __atomic_load_n(&pool_generation, __ATOMIC_ACQUIRE);
+#else
+  return pool_generation;
+#endif
+}
+
+static void pool_cache_drop(pool_cache *cache) {
+  memset(cache->blocks, 0, sizeof(cache->blocks));
+  memset(cache->spare, 0, sizeof(cache->spare));
+  memset(cache->count, 0, sizeof(cache->count));
+}
+
+// Carves a fresh batch of class `c` out of a new slab.
+static pool_block *pool_carve(uint64_t c) {
+  uint64_t size = (c + 1) * POOL_GRANULE;
+  pool_slab *slab = cj_malloc(sizeof(pool_slab) + POOL_BATCH * size);
+  slab->size = size;
+  char *base = (char *)(slab + 1);
+  pool_block *batch = NULL;
+  for (uint64_t i = POOL_BATCH; i-- > 0;) { // in address order
+    pool_block *block = (pool_block *)(base + i * size);
+    block->next = batch;
+    batch = block;
   }
+  POOL_LOCK();
+  slab->next = pool_slabs;
+  pool_slabs = slab;
+  POOL_UNLOCK();
+  return batch;
 }
 
-static void stringify_string(cj_string *string, buffer *buf) {
-  buffer_write_byte(buf, '"');
-  uint64_t len = string->len;
-  char *data = string->data;
-  for (uint64_t i = 0; i < len; ++i) {
-    char c = data[i];
-    if (c == '"') {
-      buffer_write_string(buf, "\\\"", 2);
-    } else if (c == '\\') {
-      buffer_write_string(buf, "\\\\", 2);
-    } else if (c == '/') {
-      buffer_write_byte(buf, '/');
-    } else if (c == '\b') {
-      buffer_write_string(buf, "\\b", 2);
-    } else if (c == '\f') {
-      buffer_write_string(buf, "\\f", 2);
-    } else if (c == '\n') {
-      buffer_write_string(buf, "\\n", 2);
-    } else if (c == '\r') {
-      buffer_write_string(buf, "\\r", 2);
-    } else if (c == '\t') {
-      buffer_write_string(buf, "\\t", 2);
-    } else if (c >= 0x00 && c <= 0x1F) {
-      buffer_write_string(buf, "\\u00", 4);
-      buffer_write_byte(buf, hex_chars[(uint8_t)c >> 4]);
-      buffer_write_byte(buf, hex_chars[(uint8_t)c & 0xF]);
-    } else {
-      buffer_write_byte(buf, c);
+// Gives the cache new blocks of class `c` once it has none left.
+static pool_block *pool_refill(pool_cache *cache, uint64_t c) {
+  pool_block *batch = cache->spare[c];
+  uint64_t count = POOL_BATCH;
+  if (batch != NULL) {
+    cache->spare[c] = NULL;
+  } else {
+    POOL_LOCK();
+    batch = pool_batches[c];
+    if (batch != NULL) {
+      pool_batches[c] = batch->next_batch;
+    } else if (pool_loose[c] != NULL) {
+      batch = pool_loose[c];
+      count = pool_loose_count[c];
+      pool_loose[c] = NULL;
+      pool_loose_count[c] = 0;
+    }
+    POOL_UNLOCK();
+    if (batch == NULL) {
+      batch = pool_carve(c);
     }
   }
-  buffer_write_byte(buf, '"');
+  cache->count[c] = count;
+  return batch;
 }
 
-static void stringify_value(cj_value *value, buffer *buf) {
-  if (value->type == CJ_TYPE_OBJECT) {
-    buffer_write_byte(buf, '{');
-    if (value->value.members != NULL) {
-      cj_value *p = value->value.members;
-      for (; p != NULL; p = p->next) {
-        stringify_string(p->name, buf);
-        buffer_write_byte(buf, ':');
-        stringify_value(p, buf);
-        if (p->next != NULL) {
-          buffer_write_byte(buf, ',');
-        }
-      }
+// Gives everything a thread holds back to the shared lists: the spare as a
+// batch, the rest block by block onto the loose list, which becomes a batch
+// of its own whenever it fills up.
+static void pool_cache_flush(pool_cache *cache) {
+  POOL_LOCK();
+  if (cache->generation != pool_generation) {
+    pool_cache_drop(cache);
+    POOL_UNLOCK();
+    return;
+  }
+  for (uint64_t c = 0; c < POOL_CLASSES; ++c) {
+    if (cache->spare[c] != NULL) {
+      cache->spare[c]->next_batch = pool_batches[c];
+      pool_batches[c] = cache->spare[c];
     }
-    buffer_write_byte(buf, '}');
-  } else if (value->type == CJ_TYPE_ARRAY) {
-    buffer_write_byte(buf, '[');
-    if (value->value.elements != NULL) {
-      cj_value *p = value->value.elements;
-      for (; p != NULL; p = p->next) {
-        stringify_value(p, buf);
-        if (p->next != NULL) {
-          buffer_write_byte(buf, ',');
-        }
+    pool_block *next = NULL;
+    pool_block *p = cache->blocks[c];
+    for (; p != NULL; p = next) {
+      next = p->next;
+      p->next = pool_loose[c];
+      pool_loose[c] = p;
+      if (++pool_loose_count[c] == POOL_BATCH) {
+        pool_loose[c]->next_batch = pool_batches[c];
+        pool_batches[c] = pool_loose[c];
+        pool_loose[c] = NULL;
+        pool_loose_count[c] = 0;
       }
     }
-    buffer_write_byte(buf, ']');
-  } else if (value->type == CJ_TYPE_STRING) {
-    stringify_string(value->value.string, buf);
-  } else if (value->type == CJ_TYPE_NUMBER) {
-    if (isnan(value->value.number) || isinf(value->value.number)) {
-      buffer_write_string(buf, "null", 4);
-    } else {
-      char num_buf[32];
-      int n = snprintf(num_buf, 32, "%g", value->value.number);
-      for (int i = 0; i < n; ++i) {
-        buffer_write_byte(buf, num_buf[i]);
-      }
+    cache->blocks[c] = NULL;
+    cache->spare[c] = NULL;
+    cache->count[c] = 0;
+  }
+  POOL_UNLOCK();
+}
+
+#if defined(USE_THREADS)
+static void pool_thread_exit(void *cache) {
+  pool_cache_flush(cache);
+}
+
+static void pool_key_create(void) {
+  pthread_key_create(&pool_key, pool_thread_exit);
+}
+#endif
+
+static pool_cache *pool_cache_get(void) {
+  pool_cache *cache = &pool_local;
+#if defined(USE_THREADS)
+  if (!cache->registered) { // so that the blocks are not lost when the thread exits
+    pthread_once(&pool_once, pool_key_create);
+    pthread_setspecific(pool_key, cache);
+    cache->registered = true;
+  }
+#endif
+  uint64_t generation = pool_generation_get();
+  if (cache->generation != generation) {
+    pool_cache_drop(cache);
+    cache->generation = generation;
+  }
+  return cache;
+}
+
+static void *pool_alloc(void *ctx, uint64_t size) {
+  (void)ctx;
+  if (size > POOL_CLASSES * POOL_GRANULE) {
+    return cj_malloc(size);
+  }
+  uint64_t c = size == 0 ? 0 : (size - 1) / POOL_GRANULE;
+  pool_cache *cache = pool_cache_get();
+  pool_block *block = cache->blocks[c];
+  if (block == NULL) {
+    block = pool_refill(cache, c);
+  }
+  cache->blocks[c] = block->next;
+  --cache->count[c];
+  return block;
+}
+
+static void pool_free(void *ctx, void *ptr, uint64_t size) {
+  (void)ctx;
+  if (size > POOL_CLASSES * POOL_GRANULE) {
+    cj_free(ptr);
+    return;
+  }
+  uint64_t c = size == 0 ? 0 : (size - 1) / POOL_GRANULE;
+  pool_cache *cache = pool_cache_get();
+  pool_block *block = ptr;
+  block->next = cache->blocks[c];
+  cache->blocks[c] = block;
+  if (++cache->count[c] == POOL_BATCH) {
+    if (cache->spare[c] != NULL) {
+      POOL_LOCK();
+      cache->spare[c]->next_batch = pool_batches[c];
+      pool_batches[c] = cache->spare[c];
+      POOL_UNLOCK();
     }
-  } else if (value->type == CJ_TYPE_TRUE) {
-    buffer_write_string(buf, "true", 4);
-  } else if (value->type == CJ_TYPE_FALSE) {
-    buffer_write_string(buf, "false", 5);
-  } else if (value->type == CJ_TYPE_NULL) {
-    buffer_write_string(buf, "null", 4);
+    cache->spare[c] = block;
+    cache->blocks[c] = NULL;
+    cache->count[c] = 0;
   }
 }
 
-char *cj_stringify(cj_value *value, uint64_t *len) {
-  buffer buf;
-  buffer_init(&buf);
-  stringify_value(value, &buf);
-  char *result = cj_malloc(buf.len + 1);
-  memcpy(result, buf.data, buf.len);
-  result[buf.len] = '\0';
-  if (len != NULL) {
-    *len = buf.len;
+static void *pool_realloc(void *ctx, void *ptr, uint64_t old_size, uint64_t size) {
+  uint64_t max = POOL_CLASSES * POOL_GRANULE;
+  if (old_size > max && size > max) {
+    return cj_realloc(ptr, size);
+  }
+  if (old_size <= max && size <= max && (old_size - 1) / POOL_GRANULE == (size - 1) / POOL_GRANULE) {
+    return ptr;
   }
-  buffer_clean(&buf);
+  void *result = pool_alloc(ctx, size);
+  memcpy(result, ptr, old_size < size ? old_size : size);
+  pool_free(ctx, ptr, old_size);
   return result;
 }
+
+static const cj_allocator pool_allocator = {pool_alloc, pool_realloc, NULL, pool_free, NULL};
+
+const cj_allocator *cj_pool_allocator(void) {
+  return &pool_allocator;
+}
+
+void cj_pool_trim(void) {
+  POOL_LOCK();
+  pool_slab *next = NULL;
+  pool_slab *slab = pool_slabs;
+  for (; slab != NULL; slab = next) {
+    next = slab->next;
+    cj_free(slab);
+  }
+  pool_slabs = NULL;
+  memset(pool_batches, 0, sizeof(pool_batches));
+  memset(pool_loose, 0, sizeof(pool_loose));
+  memset(pool_loose_count, 0, sizeof(pool_loose_count));
+#if defined(__GNUC__)
+  __atomic_store_n(&pool_generation, pool_generation + 1, __ATOMIC_RELEASE);
+#else
+  ++pool_generation;
+#endif
+  POOL_UNLOCK();
+}
+
+typedef struct work_queue work_queue;
+
+// Tasks 0 to count - 1 of one run_parallel call; each thread takes the
+// next one until none are left.
+struct work_queue {
+  void (*run)(void *job, uint64_t i);
+  void *job;
+  uint64_t count;
+  uint64_t next;
+#if defined(USE_THREADS)
+  pthread_mutex_t lock;
+#endif
+};
+
+static void *work_queue_drain(void *arg) {
+  work_queue *queue = arg;
+  for (;;) {
+#if defined(USE_THREADS)
+    pthread_mutex_lock(&queue->lock);
+#endif
+    uint64_t i = queue->next;
+    if (i < queue->count) {
+      ++queue->next;
+    }
+#if defined(USE_THREADS)
+    pthread_mutex_unlock(&queue->lock);
+#endif
+    if (i >= queue->count) {
+      return NULL;
+    }
+    queue->run(queue->job, i);
+  }
+}
+
+// The number of threads to use for a `threads` argument: 0 means one per
+// online CPU, and there is only one without thread support.
+static int thread_count(int threads) {
+#if defined(USE_THREADS)
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (int)cpus : 1;
+  }
+#else
+  threads = 1;
+#endif
+  return threads < 1 ? 1 : threads;
+}
+
+// Calls run(job, i) for every i below `count` on up to `threads` threads,
+// the calling thread being one of them, and returns once all are done. If
+// a thread cannot be started the others do its share.
+static void run_parallel(void (*run)(void *, uint64_t), void *job, uint64_t count, int threads) {
+  work_queue queue;
+  queue.run = run;
+  queue.job = job;
+  queue.count = count;
+  queue.next = 0;
+#if defined(USE_THREADS)
+  if ((uint64_t)threads > count) {
+    threads = (int)count;
+  }
+  if (threads > 1) {
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_t *workers = cj_malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    for (; started < threads - 1; ++started) {
+      if (pthread_create(&workers[started], NULL, work_queue_drain, &queue) != 0) {
+        break;
+      }
+    }
+    work_queue_drain(&queue);
+    for (int i = 0; i < started; ++i) {
+      pthread_join(workers[i], NULL);
+    }
+    cj_free(workers);
+    pthread_mutex_destroy(&queue.lock);
+    return;
+  }
+#endif
+  for (uint64_t i = 0; i < count; ++i) {
+    run(job, i);
+  }
+}
+
+#define LINES_PIECE_MIN (1 << 16)
+#define LINES_PIECES_PER_THREAD 4
+
+struct cj_lines {
+  arena arena;
+  cj_value **values;
+  uint64_t *offsets;
+  uint64_t count;
+};
+
+typedef struct lines_piece lines_piece;
+
+// A run of whole lines, parsed into its own arena so that pieces need no
+// locking; the results are moved into the cj_lines in order afterwards.
+struct lines_piece {
+  const char *begin;
+  const char *end;
+  arena arena;
+  cj_value **values;
+  uint64_t *offsets;
+  uint64_t count;
+  uint64_t cap;
+};
+
+static void lines_piece_parse(lines_piece *piece, const char *text) {
+  context ctx;
+  context_init(&ctx, &piece->arena, NULL);
+  const char *p = piece->begin;
+  while (p < piece->end) {
+    const char *line_end = memchr(p, '\n', piece->end - p);
+    if (line_end == NULL) {
+      line_end = piece->end;
+    }
+    const char *q = p;
+    skip_whitespace(&q, line_end); // blank lines are skipped
+    if (q != line_end) {
+      if (piece->count == piece->cap) {
+        piece->cap = piece->cap == 0 ? 64 : piece->cap << 1;
+        piece->values = cj_realloc(piece->values, piece->cap * sizeof(cj_value *));
+        piece->offsets = cj_realloc(piece->offsets, piece->cap * sizeof(uint64_t));
+      }
+      piece->values[piece->count] = parse_text(p, line_end - p, NULL, &ctx);
+      piece->offsets[piece->count] = p - text;
+      ++piece->count;
+    }
+    p = line_end + 1;
+  }
+  context_clean(&ctx);
+}
+
+typedef struct lines_job lines_job;
+
+struct lines_job {
+  const char *text;
+  lines_piece *pieces;
+};
+
+static void lines_work(void *arg, uint64_t i) {
+  lines_job *job = arg;
+  lines_piece_parse(&job->pieces[i], job->text);
+}
+
+// Cuts the text into pieces of about `size` bytes, each ending just after
+// a newline. A newline never occurs inside a JSON value (control characters
+// in strings must be escaped), so every cut is a line boundary.
+static uint64_t lines_split(const char *text, uint64_t len, uint64_t size, lines_piece **pieces) {
+  uint64_t count = 0;
+  uint64_t cap = len / size + 1;
+  *pieces = cj_malloc(cap * sizeof(lines_piece));
+  const char *p = text;
+  const char *end = text + len;
+  while (p < end) {
+    const char *cut = end;
+    if ((uint64_t)(end - p) > size) {
+      cut = memchr(p + size, '\n', end - p - size);
+      cut = cut == NULL ? end : cut + 1;
+    }
+    lines_piece *piece = &(*pieces)[count];
+    piece->begin = p;
+    piece->end = cut;
+    arena_init(&piece->arena, NULL);
+    piece->values = NULL;
+    piece->offsets = NULL;
+    piece->count = 0;
+    piece->cap = 0;
+    ++count;
+    p = cut;
+  }
+  return count;
+}
+
+cj_lines *cj_parse_lines(const char *text, uint64_t len, int threads) {
+  threads = thread_count(threads);
+  uint64_t size = len;
+  if (threads > 1) {
+    size = len / ((uint64_t)threads * LINES_PIECES_PER_THREAD);
+    if (size < LINES_PIECE_MIN) {
+      size = LINES_PIECE_MIN;
+    }
+  }
+  lines_job job;
+  job.text = text;
+  uint64_t piece_count = lines_split(text, len, size > 0 ? size : 1, &job.pieces);
+  run_parallel(lines_work, &job, piece_count, threads);
+  cj_lines *lines = cj_malloc(sizeof(cj_lines));
+  arena_init(&lines->arena, NULL);
+  lines->count = 0;
+  for (uint64_t i = 0; i < piece_count; ++i) {
+    lines->count += job.pieces[i].count;
+  }
+  lines->values = cj_malloc((lines->count + 1) * sizeof(cj_value *));
+  lines->offsets = cj_malloc((lines->count + 1) * sizeof(uint64_t));
+  uint64_t n = 0;
+  for (uint64_t i = 0; i < piece_count; ++i) {
+    lines_piece *piece = &job.pieces[i];
+    if (piece->count > 0) {
+      memcpy(lines->values + n, piece->values, piece->count * sizeof(cj_value *));
+      memcpy(lines->offsets + n, piece->offsets, piece->count * sizeof(uint64_t));
+      n += piece->count;
+    }
+    arena_merge(&lines->arena, &piece->arena);
+    cj_free(piece->values);
+    cj_free(piece->offsets);
+  }
+  cj_free(job.pieces);
+  return lines;
+}
+
+cj_lines *cj_parse_lines_file(const char *path, int threads) {
+  file_view view;
+  if (!file_view_open(&view, path)) {
+    return NULL;
+  }
+  cj_lines *lines = cj_parse_lines(view.data, view.len, threads);
+  file_view_close(&view);
+  return lines;
+}
+
+uint64_t cj_lines_count(const cj_lines *lines) {
+  return lines->count;
+}
+
+cj_value *cj_lines_get(const cj_lines *lines, uint64_t i) {
+  return i < lines->count ? lines->values[i] : NULL;
+}
+
+uint64_t cj_lines_offset(const cj_lines *lines, uint64_t i) {
+  return lines->offsets[i];
+}
+
+void cj_lines_clean(cj_lines *lines) {
+  if (lines == NULL) {
+    return;
+  }
+  arena_clean(&lines->arena);
+  cj_free(lines->values);
+  cj_free(lines->offsets);
+  cj_free(lines);
+}
+
+#define INDEXER_WINDOW_BLOCKS 256
+#define INDEXER_END UINT64_MAX
+
+#define CHAR_OP        1
+#define CHAR_WS        2
+#define CHAR_QUOTE     4
+#define CHAR_BACKSLASH 8
+
+static const uint8_t char_classes[256] = {
+  ['{'] = CHAR_OP, ['}'] = CHAR_OP, ['['] = CHAR_OP, [']'] = CHAR_OP, [':'] = CHAR_OP, [','] = CHAR_OP,
+  [' '] = CHAR_WS, ['\t'] = CHAR_WS, ['\n'] = CHAR_WS, ['\r'] = CHAR_WS,
+  ['"'] = CHAR_QUOTE, ['\\'] = CHAR_BACKSLASH,
+};
+
+typedef struct indexer indexer;
+
+// Stage 1 of the indexed parser. The input is classified 64 bytes at a time
+// into bitmaps; escaped quotes are dropped, the quotes are prefix-xored into
+// an in-string mask, and the positions of operators outside strings, opening
+// quotes and the first byte of every other scalar are written to `indexes`.
+// A window of blocks is indexed at a time, carrying state across blocks.
+struct indexer {
+  const char *text;
+  uint64_t len;
+  uint64_t offset; // start of the next block to classify
+  uint64_t prev_escaped;
+  uint64_t prev_in_string;
+  uint64_t prev_scalar;
+  uint64_t *indexes;
+  uint64_t count;
+  uint64_t next;
+};
+
+typedef struct indexer_kernel indexer_kernel;
+
+struct indexer_kernel {
+  const char *name;
+  bool (*supported)(void);
+  void (*scan)(indexer *ix, const char *data, uint64_t blocks, uint64_t base);
+};
+
+// Bit i is set if the byte at i follows an odd-length run of backslashes.
+static inline uint64_t indexer_escaped(indexer *ix, uint64_t backslash) {
+  const uint64_t even_bits = 0x5555555555555555ULL;
+  backslash &= ~ix->prev_escaped;
+  uint64_t follows_escape = backslash << 1 | ix->prev_escaped;
+  uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+  uint64_t even_runs = odd_starts + backslash;
+  ix->prev_escaped = even_runs < backslash ? 1 : 0;
+  return (even_bits ^ (even_runs << 1)) & follows_escape;
+}
+
+static inline uint64_t prefix_xor(uint64_t bits) {
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+}
+
+// `quote` holds the unescaped quotes of the block and `in_string` their
+// prefix xor: set from an opening quote up to, not including, its closing one.
+static inline void indexer_emit(indexer *ix, uint64_t base, uint64_t quote, uint64_t in_string, uint64_t op, uint64_t ws) {
+  in_string ^= ix->prev_in_string;
+  ix->prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+  uint64_t scalar = ~(op | ws | quote | in_string);
+  uint64_t scalar_start = scalar & ~(scalar << 1 | ix->prev_scalar);
+  ix->prev_scalar = scalar >> 63;
+  uint64_t bits = (op & ~in_string) | (quote & in_string) | scalar_start;
+  uint64_t *out = ix->indexes + ix->count;
+  while (bits != 0) {
+    *out++ = base + (uint64_t)__builtin_ctzll(bits);
+    bits &= bits - 1;
+  }
+  ix->count = (uint64_t)(out - ix->indexes);
+}
+
+static bool indexer_scalar_supported(void) {
+  return true;
+}
+
+static void indexer_scan_scalar(indexer *ix, const char *data, uint64_t blocks, uint64_t base) {
+  for (uint64_t b = 0; b < blocks; ++b, data += 64, base += 64) {
+    uint64_t op = 0;
+    uint64_t ws = 0;
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    for (int i = 0; i < 64; ++i) {
+      uint64_t c = char_classes[(uint8_t)data[i]];
+      op |= (c & 1) << i;
+      ws |= (c >> 1 & 1) << i;
+      quote |= (c >> 2 & 1) << i;
+      backslash |= (c >> 3 & 1) << i;
+    }
+    quote &= ~indexer_escaped(ix, backslash);
+    indexer_emit(ix, base, quote, prefix_xor(quote), op, ws);
+  }
+}
+
+#if defined(USE_CPU_DISPATCH)
+// Whitespace and operators are classified with one nibble lookup each: the
+// table entry for the low nibble is the only byte of that class it can be.
+// '[' and ']' become '{' and '}' when 0x20 is or-ed in; the control bytes
+// that alias ',' and ':' that way are rejected by stage 2.
+#define INDEXER_WS_TABLE \
+  ' ', 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, '\t', '\n', 0x80, 0x80, '\r', 0x80, 0x80
+#define INDEXER_OP_TABLE \
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0
+
+static bool indexer_sse42_supported(void) {
+  unsigned eax, ebx, ecx, edx;
+  return __builtin_cpu_supports("sse4.2") && __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_PCLMUL) != 0;
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static void indexer_scan_sse42(indexer *ix, const char *data, uint64_t blocks, uint64_t base) {
+  const __m128i ws_table = _mm_setr_epi8(INDEXER_WS_TABLE);
+  const __m128i op_table = _mm_setr_epi8(INDEXER_OP_TABLE);
+  const __m128i lower = _mm_set1_epi8(0x20);
+  const __m128i quote_char = _mm_set1_epi8('"');
+  const __m128i backslash_char = _mm_set1_epi8('\\');
+  const __m128i ones = _mm_set1_epi8((char)0xFF);
+  for (uint64_t b = 0; b < blocks; ++b, data += 64, base += 64) {
+    uint64_t op = 0;
+    uint64_t ws = 0;
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    for (int i = 0; i < 4; ++i) {
+      __m128i in = _mm_loadu_si128((const __m128i *)(data + 16 * i));
+      __m128i is_ws = _mm_cmpeq_epi8(_mm_shuffle_epi8(ws_table, in), in);
+      __m128i is_op = _mm_cmpeq_epi8(_mm_shuffle_epi8(op_table, in), _mm_or_si128(in, lower));
+      ws |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_ws) << (16 * i);
+      op |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_op) << (16 * i);
+      quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(in, quote_char)) << (16 * i);
+      backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(in, backslash_char)) << (16 * i);
+    }
+    quote &= ~indexer_escaped(ix, backslash);
+    __m128i in_string = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long)quote), ones, 0);
+    indexer_emit(ix, base, quote, (uint64_t)_mm_cvtsi128_si64(in_string), op, ws);
+  }
+}
+
+static bool indexer_avx2_supported(void) {
+  return __builtin_cpu_supports("avx2") && indexer_sse42_supported();
+}
+
+__attribute__((target("avx2,pclmul")))
+static void indexer_scan_avx2(indexer *ix, const char *data, uint64_t blocks, uint64_t base) {
+  const __m256i ws_table = _mm256_setr_epi8(INDEXER_WS_TABLE, INDEXER_WS_TABLE);
+  const __m256i op_table = _mm256_setr_epi8(INDEXER_OP_TABLE, INDEXER_OP_TABLE);
+  const __m256i lower = _mm256_set1_epi8(0x20);
+  const __m256i quote_char = _mm256_set1_epi8('"');
+  const __m256i backslash_char = _mm256_set1_epi8('\\');
+  const __m128i ones = _mm_set1_epi8((char)0xFF);
+  for (uint64_t b = 0; b < blocks; ++b, data += 64, base += 64) {
+    uint64_t op = 0;
+    uint64_t ws = 0;
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    for (int i = 0; i < 2; ++i) {
+      __m256i in = _mm256_loadu_si256((const __m256i *)(data + 32 * i));
+      __m256i is_ws = _mm256_cmpeq_epi8(_mm256_shuffle_epi8(ws_table, in), in);
+      __m256i is_op = _mm256_cmpeq_epi8(_mm256_shuffle_epi8(op_table, in), _mm256_or_si256(in, lower));
+      ws |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_ws) << (32 * i);
+      op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_op) << (32 * i);
+      quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, quote_char)) << (32 * i);
+      backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, backslash_char)) << (32 * i);
+    }
+    quote &= ~indexer_escaped(ix, backslash);
+    __m128i in_string = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long)quote), ones, 0);
+    indexer_emit(ix, base, quote, (uint64_t)_mm_cvtsi128_si64(in_string), op, ws);
+  }
+}
+#endif
+
+// Best first; the scalar kernel runs everywhere.
+static const indexer_kernel indexer_kernels[] = {
+#if defined(USE_CPU_DISPATCH)
+  {"avx2", indexer_avx2_supported, indexer_scan_avx2},
+  {"sse4.2", indexer_sse42_supported, indexer_scan_sse42},
+#endif
+  {"scalar", indexer_scalar_supported, indexer_scan_scalar},
+};
+
+static const indexer_kernel *indexer_selected = NULL;
+
+static const indexer_kernel *indexer_kernel_get(void) {
+  if (indexer_selected == NULL) {
+    const indexer_kernel *kernel = indexer_kernels;
+    while (!kernel->supported()) {
+      ++kernel;
+    }
+    indexer_selected = kernel;
+  }
+  return indexer_selected;
+}
+
+const char *cj_simd_kernel(void) {
+  return indexer_kernel_get()->name;
+}
+
+bool cj_simd_select(const char *name) {
+  for (uint64_t i = 0; i < sizeof(indexer_kernels) / sizeof(indexer_kernels[0]); ++i) {
+    const indexer_kernel *kernel = &indexer_kernels[i];
+    if (strcmp(kernel->name, name) == 0 && kernel->supported()) {
+      indexer_selected = kernel;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void indexer_init(indexer *ix, const char *text, uint64_t len) {
+  memset(ix, 0, sizeof(indexer));
+  ix->text = text;
+  ix->len = len;
+  uint64_t blocks = len / 64 + 1;
+  if (blocks > INDEXER_WINDOW_BLOCKS) {
+    blocks = INDEXER_WINDOW_BLOCKS;
+  }
+  ix->indexes = cj_malloc(blocks * 64 * sizeof(uint64_t));
+}
+
+static void indexer_clean(indexer *ix) {
+  cj_free(ix->indexes);
+}
+
+// Indexes the next window; the last partial block is classified from a copy
+// padded with spaces. Returns false at the end of the input.
+static bool indexer_refill(indexer *ix) {
+  ix->count = 0;
+  ix->next = 0;
+  if (ix->offset >= ix->len) {
+    return false;
+  }
+  const indexer_kernel *kernel = indexer_kernel_get();
+  uint64_t blocks = (ix->len - ix->offset) / 64;
+  if (blocks > INDEXER_WINDOW_BLOCKS) {
+    blocks = INDEXER_WINDOW_BLOCKS;
+  }
+  if (blocks > 0) {
+    kernel->scan(ix, ix->text + ix->offset, blocks, ix->offset);
+    ix->offset += blocks * 64;
+  } else {
+    char tail[64];
+    memset(tail, ' ', sizeof(tail));
+    memcpy(tail, ix->text + ix->offset, ix->len - ix->offset);
+    kernel->scan(ix, tail, 1, ix->offset);
+    ix->offset = ix->len;
+  }
+  return true;
+}
+
+static uint64_t indexer_next(indexer *ix) {
+  while (ix->next == ix->count) {
+    if (!indexer_refill(ix)) {
+      return INDEXER_END;
+    }
+  }
+  return ix->indexes[ix->next++];
+}
+
+// Stage 2: walks the structural positions with an explicit stack. Every
+// token is decoded by the same routines as parse_value, and must end where
+// the whitespace before the next position begins, so anything stage 1
+// classified differently is caught as a syntax error.
+static cj_value *indexed_build(indexer *ix, const char **pp, context *ctx) {
+  const char *text = ix->text;
+  const char *end = ctx->end;
+  const char *p = *pp;
+  cj_value *root = NULL;
+  cj_value *value;
+  cj_string *name = NULL;
+  parse_frame *stack = NULL;
+  uint64_t depth = 0;
+  uint64_t cap = 0;
+  uint64_t pos = indexer_next(ix);
+  char c;
+label_value:
+  if (pos == INDEXER_END) {
+    p = end;
+    goto label_error;
+  }
+  p = text + pos;
+  c = *p;
+  if (c == '{' || c == '[') {
+    value = create_cj_value(ctx, c == '{' ? CJ_TYPE_OBJECT : CJ_TYPE_ARRAY);
+  } else if (c == '"') {
+    cj_string *string = parse_string_raw(&p, ctx);
+    if (string == NULL) {
+      goto label_error;
+    }
+    value = create_cj_value(ctx, CJ_TYPE_STRING);
+    value->value.string = string;
+  } else if ((c >= '0' && c <= '9') || c == '-') {
+    bool ok;
+    double number = parse_number_raw(&p, end, &ok);
+    if (!ok) {
+      goto label_error;
+    }
+    value = create_cj_value(ctx, CJ_TYPE_NUMBER);
+    value->value.number = number;
+  } else if (c == 't' && check_literal(&p, end, "true", 4)) {
+    value = create_cj_value(ctx, CJ_TYPE_TRUE);
+  } else if (c == 'f' && check_literal(&p, end, "false", 5)) {
+    value = create_cj_value(ctx, CJ_TYPE_FALSE);
+  } else if (c == 'n' && check_literal(&p, end, "null", 4)) {
+    value = create_cj_value(ctx, CJ_TYPE_NULL);
+  } else {
+    goto label_error;
+  }
+  if (depth == 0) {
+    root = value;
+  } else {
+    value->name = name;
+    name = NULL;
+    parse_frame_append(&stack[depth - 1], value);
+  }
+  if (c == '{' || c == '[') {
+    if (!parse_frame_push(&stack, &depth, &cap, value, ctx->allocator)) {
+      goto label_error;
+    }
+    pos = indexer_next(ix);
+    if (pos != INDEXER_END && text[pos] == (c == '{' ? '}' : ']')) {
+      goto label_close;
+    }
+    if (c == '{') {
+      goto label_name;
+    }
+    goto label_value;
+  }
+  pos = indexer_next(ix);
+  skip_whitespace(&p, end); // ws
+  if (p != (pos == INDEXER_END ? end : text + pos)) {
+    goto label_error;
+  }
+label_next:
+  if (pos == INDEXER_END) {
+    p = end;
+    if (depth != 0) {
+      goto label_error;
+    }
+    goto label_return;
+  }
+  p = text + pos;
+  if (depth == 0) {
+    goto label_error;
+  }
+  c = *p;
+  if (c == ',') {
+    pos = indexer_next(ix);
+    if (stack[depth - 1].container->type == CJ_TYPE_OBJECT) {
+      goto label_name;
+    }
+    goto label_value;
+  }
+  if (c != (stack[depth - 1].container->type == CJ_TYPE_OBJECT ? '}' : ']')) {
+    goto label_error;
+  }
+label_close:
+  --depth;
+  parse_frame_close(&stack[depth], ctx);
+  pos = indexer_next(ix);
+  goto label_next;
+label_name:
+  if (pos == INDEXER_END) {
+    p = end;
+    goto label_error;
+  }
+  p = text + pos;
+  if (*p != '"' || (name = parse_string_raw(&p, ctx)) == NULL) {
+    goto label_error;
+  }
+  pos = indexer_next(ix);
+  skip_whitespace(&p, end); // ws
+  if (pos == INDEXER_END || p != text + pos || *p != ':') {
+    goto label_error;
+  }
+  pos = indexer_next(ix);
+  goto label_value;
+label_error:
+  context_free_string(ctx, name);
+  context_free_value(ctx, root);
+  root = NULL;
+label_return:
+  allocator_free(ctx->allocator, stack, cap * sizeof(parse_frame));
+  *pp = p;
+  return root;
+}
+
+static cj_value *parse_text_indexed(const char *text, uint64_t len, char **end, context *ctx) {
+  const char *p = text;
+  ctx->end = text + len;
+  indexer ix;
+  indexer_init(&ix, text, len);
+  cj_value *value = indexed_build(&ix, &p, ctx);
+  indexer_clean(&ix);
+  if (end != NULL) {
+    *end = (char *)p;
+  }
+  return value;
+}
+
+cj_value *cj_parse_indexed(const char *text, uint64_t len, char **end) {
+  context ctx;
+  context_init(&ctx, NULL, NULL);
+  cj_value *value = parse_text_indexed(text, len, end, &ctx);
+  context_clean(&ctx);
+  return value;
+}
+
+cj_doc *cj_doc_parse_indexed(const char *text, uint64_t len, char **end) {
+  cj_doc *doc = cj_malloc(sizeof(cj_doc));
+  arena_init(&doc->arena, NULL);
+  context ctx;
+  context_init(&ctx, &doc->arena, NULL);
+  doc->root = parse_text_indexed(text, len, end, &ctx);
+  context_clean(&ctx);
+  if (doc->root == NULL) {
+    cj_doc_clean(doc);
+    doc = NULL;
+  }
+  return doc;
+}
+
+// Moves past the string whose body starts at p; escapes are stepped over,
+// not decoded or checked.
+static const char *skip_string(const char *p, const char *end) {
+  for (;;) {
+    p += scan_string_run(p, end);
+    if (p >= end) {
+      return NULL;
+    }
+    if (*p == '"') {
+      return p + 1;
+    }
+    p += *p == '\\' ? 2 : 1;
+  }
+}
+
+// Moves past the value at p without decoding it. Scalars run up to the next
+// whitespace or operator; containers are crossed by counting brackets
+// outside strings. Returns NULL if the input ends first.
+static const char *skip_value(const char *p, const char *end) {
+  char c = peek(p, end);
+  if (c == '"') {
+    return skip_string(p + 1, end);
+  }
+  if (c != '{' && c != '[') {
+    while (p < end && char_classes[(uint8_t)*p] == 0) {
+      ++p;
+    }
+    return p;
+  }
+  uint64_t depth = 0;
+  while (p < end) {
+    c = *p;
+    if (c == '"') {
+      p = skip_string(p + 1, end);
+      if (p == NULL) {
+        return NULL;
+      }
+      continue;
+    }
+    if (c == '{' || c == '[') {
+      ++depth;
+    } else if ((c == '}' || c == ']') && --depth == 0) {
+      return p + 1;
+    }
+    ++p;
+  }
+  return NULL;
+}
+
+// Compares the name token at p with `key`, decoding it only if it has
+// escapes.
+static bool cursor_name_equals(const char *p, const char *end, const char *key, uint64_t len) {
+  ++p; // '"'
+  uint64_t run = scan_string_run(p, end);
+  if (p + run < end && p[run] == '"') {
+    return run == len && memcmp(p, key, len) == 0;
+  }
+  context ctx;
+  context_init(&ctx, NULL, NULL);
+  ctx.end = end;
+  --p;
+  bool result = decode_string(&p, &ctx) && ctx.scratch.len == len && memcmp(ctx.scratch.data, key, len) == 0;
+  context_clean(&ctx);
+  return result;
+}
+
+// Positions `cur` on the value of the member whose name is at p.
+static bool cursor_enter_member(cj_cursor *cur, const char *p) {
+  if (peek(p, cur->end) != '"') {
+    return false;
+  }
+  cur->name = p;
+  p = skip_string(p + 1, cur->end);
+  if (p == NULL) {
+    return false;
+  }
+  skip_whitespace(&p, cur->end); // ws
+  if (peek(p, cur->end) != ':') {
+    return false;
+  }
+  ++p; // ':'
+  skip_whitespace(&p, cur->end); // ws
+  cur->p = p;
+  return true;
+}
+
+bool cj_cursor_init(cj_cursor *cur, const char *text, uint64_t len) {
+  const char *p = text;
+  cur->end = text + len;
+  cur->name = NULL;
+  skip_whitespace(&p, cur->end); // ws
+  cur->p = p;
+  return p != cur->end;
+}
+
+int cj_cursor_type(const cj_cursor *cur) {
+  char c = peek(cur->p, cur->end);
+  if (c == '{') {
+    return CJ_TYPE_OBJECT;
+  } else if (c == '[') {
+    return CJ_TYPE_ARRAY;
+  } else if (c == '"') {
+    return CJ_TYPE_STRING;
+  } else if ((c >= '0' && c <= '9') || c == '-') {
+    return CJ_TYPE_NUMBER;
+  } else if (c == 't') {
+    return CJ_TYPE_TRUE;
+  } else if (c == 'f') {
+    return CJ_TYPE_FALSE;
+  } else if (c == 'n') {
+    return CJ_TYPE_NULL;
+  }
+  return 0;
+}
+
+bool cj_cursor_first(const cj_cursor *cur, cj_cursor *child) {
+  char c = peek(cur->p, cur->end);
+  if (c != '{' && c != '[') {
+    return false;
+  }
+  const char *p = cur->p + 1; // '{' '['
+  skip_whitespace(&p, cur->end); // ws
+  if (peek(p, cur->end) == (c == '{' ? '}' : ']')) {
+    return false;
+  }
+  child->end = cur->end;
+  child->name = NULL;
+  child->p = p;
+  return c == '[' || cursor_enter_member(child, p);
+}
+
+bool cj_cursor_next(cj_cursor *cur) {
+  const char *p = skip_value(cur->p, cur->end);
+  if (p == NULL) {
+    return false;
+  }
+  skip_whitespace(&p, cur->end); // ws
+  if (peek(p, cur->end) != ',') {
+    return false;
+  }
+  ++p; // ','
+  skip_whitespace(&p, cur->end); // ws
+  if (cur->name != NULL) {
+    return cursor_enter_member(cur, p);
+  }
+  cur->p = p;
+  return true;
+}
+
+bool cj_cursor_find(const cj_cursor *object, const char *key, uint64_t len, cj_cursor *member) {
+  if (peek(object->p, object->end) != '{' || !cj_cursor_first(object, member)) {
+    return false;
+  }
+  do {
+    if (cursor_name_equals(member->name, member->end, key, len)) {
+      return true;
+    }
+  } while (cj_cursor_next(member));
+  return false;
+}
+
+bool cj_cursor_at(const cj_cursor *array, uint64_t i, cj_cursor *element) {
+  if (peek(array->p, array->end) != '[' || !cj_cursor_first(array, element)) {
+    return false;
+  }
+  for (; i > 0; --i) {
+    if (!cj_cursor_next(element)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool cj_cursor_number(const cj_cursor *cur, double *number) {
+  const char *p = cur->p;
+  bool ok;
+  *number = parse_number_raw(&p, cur->end, &ok);
+  return ok && (p == cur->end || char_classes[(uint8_t)*p] & (CHAR_OP | CHAR_WS));
+}
+
+static cj_string *cursor_decode_string(const char *p, const char *end) {
+  context ctx;
+  context_init(&ctx, NULL, NULL);
+  ctx.end = end;
+  cj_string *string = parse_string_raw(&p, &ctx);
+  context_clean(&ctx);
+  return string;
+}
+
+cj_string *cj_cursor_string(const cj_cursor *cur) {
+  return cursor_decode_string(cur->p, cur->end);
+}
+
+cj_string *cj_cursor_name(const cj_cursor *member) {
+  if (member->name == NULL) {
+    return NULL;
+  }
+  return cursor_decode_string(member->name, member->end);
+}
+
+cj_value *cj_cursor_value(const cj_cursor *cur) {
+  const char *p = cur->p;
+  context ctx;
+  context_init(&ctx, NULL, NULL);
+  ctx.end = cur->end;
+  cj_value *value = parse_value(&p, &ctx);
+  context_clean(&ctx);
+  return value;
+}
+
+// Reads the same events as parse_value, but hands each to the handlers
+// instead of building a tree, so nothing is allocated besides the scratch
+// buffer.
+bool cj_sax_parse(const char *text, uint64_t len, const cj_sax *sax, void *user, char **end) {
+  const char *p = text;
+  bool result = true;
+  context ctx;
+  context_init(&ctx, NULL, NULL);
+  ctx.end = text + len;
+  buffer *buf = &ctx.scratch;
+  reader r;
+  skip_whitespace(&p, ctx.end); // ws
+  reader_init(&r, p, &ctx);
+  for (;;) {
+    int event = reader_next(&r);
+    bool ok = true;
+    if (event == EVENT_OBJECT) {
+      ok = sax->start_object == NULL || sax->start_object(user);
+    } else if (event == EVENT_ARRAY) {
+      ok = sax->start_array == NULL || sax->start_array(user);
+    } else if (event == EVENT_OBJECT_END) {
+      ok = sax->end_object == NULL || sax->end_object(user);
+    } else if (event == EVENT_ARRAY_END) {
+      ok = sax->end_array == NULL || sax->end_array(user);
+    } else if (event == EVENT_NAME) {
+      *buffer_reserve(buf, 1) = '\0';
+      ok = sax->key == NULL || sax->key(user, buf->data, buf->len);
+    } else if (event == EVENT_STRING) {
+      *buffer_reserve(buf, 1) = '\0';
+      ok = sax->string == NULL || sax->string(user, buf->data, buf->len);
+    } else if (event == EVENT_NUMBER) {
+      ok = sax->number == NULL || sax->number(user, r.number);
+    } else if (event == EVENT_TRUE || event == EVENT_FALSE) {
+      ok = sax->boolean == NULL || sax->boolean(user, event == EVENT_TRUE);
+    } else if (event == EVENT_NULL) {
+      ok = sax->null == NULL || sax->null(user);
+    } else if (event == EVENT_END) {
+      break;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      p = r.p;
+      goto label_error;
+    }
+  }
+  p = r.p;
+  skip_whitespace(&p, ctx.end); // ws
+  if (p != ctx.end) {
+    goto label_error;
+  }
+  goto label_return;
+label_error:
+  result = false;
+label_return:
+  context_clean(&ctx);
+  if (end != NULL) {
+    *end = (char *)p;
+  }
+  return result;
+}
+
+#define SPLIT_SEGMENT_MIN (1 << 20)
+#define SPLIT_SEGMENTS_PER_THREAD 4
+#define SPLIT_WINDOW (1 << 20)
+
+static bool is_whitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Guesses a position at or after p that is outside any string, from the
+// first unescaped quote whose neighbours tell which side it is on: a
+// closing quote is followed by ':' ',' '}' or ']', an opening one comes
+// after '{' '[' ',' or ':'. Returns NULL if no quote in the window decides.
+static const char *split_outside_string(const char *text, const char *p, const char *end) {
+  for (; (p = memchr(p, '"', end - p)) != NULL; ++p) {
+    const char *q = p;
+    while (q > text && q[-1] == '\\') {
+      --q;
+    }
+    if ((p - q) % 2 != 0) { // escaped
+      continue;
+    }
+    const char *next = p + 1;
+    skip_whitespace(&next, end);
+    char c = peek(next, end);
+    bool closing = c == ':' || c == ',' || c == '}' || c == ']';
+    const char *prev = p;
+    while (prev > text && is_whitespace(prev[-1])) {
+      --prev;
+    }
+    c = prev > text ? prev[-1] : '\0';
+    bool opening = c == '{' || c == '[' || c == ',' || c == ':';
+    if (closing != opening) {
+      return closing ? p + 1 : p;
+    }
+  }
+  return NULL;
+}
+
+// The first comma at the lowest nesting level in [p, end), p being outside
+// any string. Once the window has passed from one element of the root array
+// to the next this is a comma of the root array; if it has not, the guess
+// is wrong and parsing the segments finds out.
+static const char *split_find_comma(const char *p, const char *end) {
+  const char *comma = NULL;
+  int64_t depth = 0;
+  int64_t comma_depth = INT64_MAX;
+  while (p < end) {
+    char c = *p++;
+    if (c == '"') {
+      p = skip_string(p, end);
+      if (p == NULL) {
+        break;
+      }
+    } else if (c == '{' || c == '[') {
+      ++depth;
+    } else if (c == '}' || c == ']') {
+      --depth;
+    } else if (c == ',' && depth < comma_depth) {
+      comma = p - 1;
+      comma_depth = depth;
+    }
+  }
+  return comma;
+}
+
+typedef struct split_segment split_segment;
+
+// Elements of the root array from the one at `begin` up to the comma at
+// `stop`, or to the closing bracket if `stop` is NULL. `ok` is set if they
+// parse and end exactly there, which confirms the next segment's start.
+struct split_segment {
+  const char *begin;
+  const char *stop;
+  arena arena;
+  cj_value *head;
+  cj_value *tail;
+  bool ok;
+};
+
+typedef struct split_job split_job;
+
+struct split_job {
+  const char *end;
+  split_segment *segments;
+};
+
+static void split_work(void *arg, uint64_t i) {
+  split_job *job = arg;
+  split_segment *segment = &job->segments[i];
+  context ctx;
+  context_init(&ctx, &segment->arena, NULL);
+  ctx.end = job->end;
+  ctx.depth = 1; // inside the root array
+  const char *p = segment->begin;
+  skip_whitespace(&p, ctx.end); // ws
+  for (;;) {
+    cj_value *value = parse_value(&p, &ctx); // value
+    if (value == NULL || (segment->stop != NULL && p > segment->stop)) {
+      break;
+    }
+    if (segment->tail != NULL) {
+      segment->tail->next = value;
+    } else {
+      segment->head = value;
+    }
+    segment->tail = value;
+    skip_whitespace(&p, ctx.end); // ws
+    if (peek(p, ctx.end) == ',') {
+      if (segment->stop != NULL && p >= segment->stop) {
+        segment->ok = p == segment->stop;
+        break;
+      }
+      ++p; // ','
+      skip_whitespace(&p, ctx.end); // ws
+      continue;
+    }
+    if (peek(p, ctx.end) == ']' && segment->stop == NULL) {
+      ++p; // ']'
+      skip_whitespace(&p, ctx.end); // ws
+      segment->ok = p == ctx.end;
+    }
+    break;
+  }
+  context_clean(&ctx);
+}
+
+cj_doc *cj_doc_parse_parallel(const char *text, uint64_t len, int threads, char **end) {
+  threads = thread_count(threads);
+  const char *text_end = text + len;
+  const char *p = text;
+  skip_whitespace(&p, text_end); // ws
+  uint64_t count = len / SPLIT_SEGMENT_MIN;
+  if (count > (uint64_t)threads * SPLIT_SEGMENTS_PER_THREAD) {
+    count = (uint64_t)threads * SPLIT_SEGMENTS_PER_THREAD;
+  }
+  if (threads == 1 || count < 2 || peek(p, text_end) != '[') {
+    return cj_doc_parse_n(text, len, end);
+  }
+  ++p; // '['
+  split_segment *segments = cj_malloc(count * sizeof(split_segment));
+  uint64_t n = 0;
+  segments[0].begin = p;
+  for (uint64_t k = 1; k < count; ++k) {
+    const char *from = text + len / count * k;
+    const char *window_end = (uint64_t)(text_end - from) > SPLIT_WINDOW ? from + SPLIT_WINDOW : text_end;
+    const char *outside = split_outside_string(text, from, window_end);
+    const char *comma = outside != NULL ? split_find_comma(outside, window_end) : NULL;
+    if (comma == NULL || comma <= segments[n].begin) {
+      continue;
+    }
+    segments[n].stop = comma;
+    segments[++n].begin = comma + 1;
+  }
+  segments[n++].stop = NULL;
+  for (uint64_t i = 0; i < n; ++i) {
+    arena_init(&segments[i].arena, NULL);
+    segments[i].head = NULL;
+    segments[i].tail = NULL;
+    segments[i].ok = false;
+  }
+  split_job job;
+  job.end = text_end;
+  job.segments = segments;
+  run_parallel(split_work, &job, n, threads);
+  bool ok = true;
+  for (uint64_t i = 0; i < n; ++i) {
+    ok = ok && segments[i].ok;
+  }
+  cj_doc *doc = NULL;
+  if (ok) {
+    doc = cj_malloc(sizeof(cj_doc));
+    arena_init(&doc->arena, NULL);
+    container_node *node = arena_alloc(&doc->arena, sizeof(container_node));
+    memset(node, 0, sizeof(container_node));
+    cj_value *root = &node->value;
+    root->type = CJ_TYPE_ARRAY;
+    root->flags = VALUE_CONTAINER;
+    root->value.elements = segments[0].head;
+    for (uint64_t i = 0; i < n; ++i) {
+      if (i + 1 < n) {
+        segments[i].tail->next = segments[i + 1].head;
+      }
+      arena_merge(&doc->arena, &segments[i].arena);
+    }
+    node->index = build_array_index(root, count_members(root), &doc->arena, NULL);
+    doc->root = root;
+    if (end != NULL) {
+      *end = (char *)text_end;
+    }
+  } else {
+    for (uint64_t i = 0; i < n; ++i) {
+      arena_clean(&segments[i].arena);
+    }
+  }
+  cj_free(segments);
+  return doc != NULL ? doc : cj_doc_parse_n(text, len, end); // a guess was wrong
+}
+
+#define TAPE_TYPE_SHIFT 56
+#define TAPE_PAYLOAD_MASK ((1ULL << TAPE_TYPE_SHIFT) - 1)
+
+// One word per value in document order; the top byte is the JSON character
+// that starts (or ends) it. '{' and '[' hold the position of their closing
+// word, '}' and ']' hold the number of members/elements, '"' holds the
+// offset of a cj_string in `strings`, and 'd' is followed by the bits of the
+// double.
+struct cj_tape {
+  uint64_t *words;
+  uint64_t len;
+  uint64_t cap;
+  buffer strings;
+};
+
+static void tape_append_word(cj_tape *tape, uint64_t word) {
+  if (tape->len == tape->cap) {
+    tape->cap <<= 1;
+    tape->words = cj_realloc(tape->words, tape->cap * sizeof(uint64_t));
+  }
+  tape->words[tape->len++] = word;
+}
+
+static void tape_append(cj_tape *tape, uint8_t type, uint64_t payload) {
+  tape_append_word(tape, ((uint64_t)type << TAPE_TYPE_SHIFT) | payload);
+}
+
+static void tape_append_string(cj_tape *tape, buffer *string) {
+  buffer *strings = &tape->strings;
+  uint64_t offset = (strings->len + 7) & ~7ULL;
+  char *out = buffer_reserve(strings, offset - strings->len + sizeof(cj_string) + string->len + 1);
+  memset(out, 0, offset - strings->len);
+  cj_string *result = (cj_string *)(strings->data + offset);
+  result->len = string->len;
+  result->data = NULL; // set by tape_link_strings once `strings` stops moving
+  memcpy(result + 1, string->data, string->len);
+  ((char *)(result + 1))[string->len] = '\0';
+  strings->len = offset + sizeof(cj_string) + string->len + 1;
+  tape_append(tape, '"', offset);
+}
+
+typedef struct tape_frame tape_frame;
+
+struct tape_frame {
+  uint64_t open;
+  uint64_t count;
+};
+
+static bool tape_build(cj_tape *tape, const char **pp, context *ctx) {
+  const char *p = *pp;
+  const char *end = ctx->end;
+  bool result = true;
+  tape_frame *stack = NULL;
+  uint64_t depth = 0;
+  uint64_t cap = 0;
+  char c;
+label_value:
+  c = peek(p, end);
+  if (c == '{' || c == '[') {
+    if (depth == CJ_MAX_DEPTH) {
+      goto label_error;
+    }
+    if (depth == cap) {
+      cap = cap == 0 ? 16 : cap << 1;
+      stack = cj_realloc(stack, cap * sizeof(tape_frame));
+    }
+    stack[depth].open = tape->len;
+    stack[depth].count = 0;
+    ++depth;
+    tape_append(tape, c, 0);
+    ++p; // '{' '['
+    skip_whitespace(&p, end); // ws
+    if (peek(p, end) == (c == '{' ? '}' : ']')) {
+      goto label_close;
+    }
+    if (c == '{') {
+      goto label_name;
+    }
+    goto label_value;
+  } else if (c == '"') {
+    if (!decode_string(&p, ctx)) {
+      goto label_error;
+    }
+    tape_append_string(tape, &ctx->scratch);
+  } else if ((c >= '0' && c <= '9') || c == '-') {
+    bool ok;
+    double number = parse_number_raw(&p, end, &ok);
+    if (!ok) {
+      goto label_error;
+    }
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    tape_append(tape, 'd', 0);
+    tape_append_word(tape, bits);
+  } else if (c == 't' && check_literal(&p, end, "true", 4)) {
+    tape_append(tape, 't', 0);
+  } else if (c == 'f' && check_literal(&p, end, "false", 5)) {
+    tape_append(tape, 'f', 0);
+  } else if (c == 'n' && check_literal(&p, end, "null", 4)) {
+    tape_append(tape, 'n', 0);
+  } else {
+    goto label_error;
+  }
+label_next:
+  if (depth == 0) {
+    goto label_return;
+  }
+  ++stack[depth - 1].count;
+  skip_whitespace(&p, end); // ws
+  c = peek(p, end);
+  if (c == ',') {
+    ++p; // ','
+    skip_whitespace(&p, end); // ws
+    if ((tape->words[stack[depth - 1].open] >> TAPE_TYPE_SHIFT) == '{') {
+      goto label_name;
+    }
+    goto label_value;
+  }
+  if (c != ((tape->words[stack[depth - 1].open] >> TAPE_TYPE_SHIFT) == '{' ? '}' : ']')) {
+    goto label_error;
+  }
+label_close:
+  ++p; // '}' ']'
+  {
+    tape_frame *top = &stack[--depth];
+    uint8_t type = (uint8_t)(tape->words[top->open] >> TAPE_TYPE_SHIFT);
+    tape->words[top->open] |= tape->len;
+    tape_append(tape, type == '{' ? '}' : ']', top->count);
+  }
+  goto label_next;
+label_name:
+  if (peek(p, end) != '"' || !decode_string(&p, ctx)) {
+    goto label_error;
+  }
+  tape_append_string(tape, &ctx->scratch);
+  skip_whitespace(&p, end); // ws
+  if (peek(p, end) != ':') {
+    goto label_error;
+  }
+  ++p; // ':'
+  skip_whitespace(&p, end); // ws
+  goto label_value;
+label_error:
+  result = false;
+label_return:
+  cj_free(stack);
+  *pp = p;
+  return result;
+}
+
+// Points each string at its bytes, which follow the header in `strings`.
+static void tape_link_strings(cj_tape *tape) {
+  uint64_t i = 0;
+  while (i < tape->len) {
+    uint8_t type = (uint8_t)(tape->words[i] >> TAPE_TYPE_SHIFT);
+    if (type == '"') {
+      cj_string *string = (cj_string *)(tape->strings.data + (tape->words[i] & TAPE_PAYLOAD_MASK));
+      string->data = (char *)(string + 1);
+    }
+    i += type == 'd' ? 2 : 1;
+  }
+}
+
+cj_tape *cj_tape_parse(const char *text, uint64_t len, char **end) {
+  cj_tape *tape = cj_malloc(sizeof(cj_tape));
+  tape->cap = 64;
+  tape->len = 0;
+  tape->words = cj_malloc(tape->cap * sizeof(uint64_t));
+  buffer_init(&tape->strings, NULL);
+  context ctx;
+  context_init(&ctx, NULL, NULL);
+  ctx.end = text + len;
+  const char *p = text;
+  skip_whitespace(&p, ctx.end); // ws
+  bool ok = tape_build(tape, &p, &ctx);
+  skip_whitespace(&p, ctx.end); // ws
+  if (!ok || p != ctx.end) {
+    cj_tape_clean(tape);
+    tape = NULL;
+  } else {
+    tape_link_strings(tape);
+  }
+  context_clean(&ctx);
+  if (end != NULL) {
+    *end = (char *)p;
+  }
+  return tape;
+}
+
+void cj_tape_clean(cj_tape *tape) {
+  if (tape == NULL) {
+    return;
+  }
+  cj_free(tape->words);
+  buffer_clean(&tape->strings);
+  cj_free(tape);
+}
+
+int cj_tape_type(const cj_tape *tape, uint64_t pos) {
+  switch (tape->words[pos] >> TAPE_TYPE_SHIFT) {
+  case '{':
+    return CJ_TYPE_OBJECT;
+  case '[':
+    return CJ_TYPE_ARRAY;
+  case '"':
+    return CJ_TYPE_STRING;
+  case 'd':
+    return CJ_TYPE_NUMBER;
+  case 't':
+    return CJ_TYPE_TRUE;
+  case 'f':
+    return CJ_TYPE_FALSE;
+  case 'n':
+    return CJ_TYPE_NULL;
+  }
+  return 0;
+}
+
+uint64_t cj_tape_skip(const cj_tape *tape, uint64_t pos) {
+  uint64_t word = tape->words[pos];
+  uint8_t type = (uint8_t)(word >> TAPE_TYPE_SHIFT);
+  if (type == '{' || type == '[') {
+    return (word & TAPE_PAYLOAD_MASK) + 1;
+  } else if (type == 'd') {
+    return pos + 2;
+  }
+  return pos + 1;
+}
+
+uint64_t cj_tape_size(const cj_tape *tape, uint64_t pos) {
+  uint64_t close = tape->words[pos] & TAPE_PAYLOAD_MASK;
+  return tape->words[close] & TAPE_PAYLOAD_MASK;
+}
+
+const cj_string *cj_tape_string(const cj_tape *tape, uint64_t pos) {
+  return (const cj_string *)(tape->strings.data + (tape->words[pos] & TAPE_PAYLOAD_MASK));
+}
+
+double cj_tape_number(const cj_tape *tape, uint64_t pos) {
+  double number;
+  memcpy(&number, &tape->words[pos + 1], sizeof(number));
+  return number;
+}
+
+uint64_t cj_tape_object_get(const cj_tape *tape, uint64_t pos, const char *key, uint64_t len) {
+  uint64_t close = tape->words[pos] & TAPE_PAYLOAD_MASK;
+  uint64_t i = pos + 1;
+  while (i < close) {
+    if (name_equals(cj_tape_string(tape, i), key, len)) {
+      return i + 1;
+    }
+    i = cj_tape_skip(tape, i + 1);
+  }
+  return CJ_TAPE_NONE;
+}
+
+#define PARSER_VALUE        0 // a value
+#define PARSER_ARRAY_FIRST  1 // a value or ']'
+#define PARSER_OBJECT_FIRST 2 // a name or '}'
+#define PARSER_NAME         3 // a name
+#define PARSER_COLON        4 // ':'
+#define PARSER_NEXT         5 // ',' or the closing bracket of the container
+#define PARSER_DONE         6 // trailing whitespace only
+#define PARSER_ERROR        7
+
+#define TOKEN_NONE    0
+#define TOKEN_STRING  1
+#define TOKEN_NUMBER  2
+#define TOKEN_LITERAL 3
+
+// Resumable parser state. Structure is tracked on an explicit stack; a
+// string, number or literal cut by the end of a chunk is kept in `pending`
+// (or `matched` for literals) until the rest arrives, then decoded with the
+// same routines as cj_parse.
+struct cj_parser {
+  context ctx;
+  int state;
+  cj_value *root;
+  parse_frame *stack;
+  uint64_t depth;
+  uint64_t cap;
+  cj_string *name;
+  int token;
+  buffer pending;
+  bool escape;
+  int literal_type;
+  const char *literal;
+  uint64_t literal_len;
+  uint64_t matched;
+};
+
+static void parser_reset(cj_parser *parser) {
+  cj_clean(parser->root);
+  cj_free(parser->name);
+  parser->state = PARSER_VALUE;
+  parser->root = NULL;
+  parser->depth = 0;
+  parser->name = NULL;
+  parser->token = TOKEN_NONE;
+  parser->pending.len = 0;
+  parser->escape = false;
+}
+
+cj_parser *cj_parser_create(void) {
+  cj_parser *parser = cj_malloc(sizeof(cj_parser));
+  memset(parser, 0, sizeof(cj_parser));
+  context_init(&parser->ctx, NULL, NULL);
+  buffer_init(&parser->pending, NULL);
+  parser->cap = 16;
+  parser->stack = cj_malloc(parser->cap * sizeof(parse_frame));
+  parser_reset(parser);
+  return parser;
+}
+
+void cj_parser_clean(cj_parser *parser) {
+  if (parser == NULL) {
+    return;
+  }
+  parser_reset(parser);
+  buffer_clean(&parser->pending);
+  context_clean(&parser->ctx);
+  cj_free(parser->stack);
+  cj_free(parser);
+}
+
+// Links `value` into the tree; opening a container fails beyond
+// CJ_MAX_DEPTH (the value is still owned by the tree).
+static bool parser_add_value(cj_parser *parser, cj_value *value) {
+  if (parser->depth == 0) {
+    parser->root = value;
+    parser->state = PARSER_DONE;
+  } else {
+    parse_frame *top = &parser->stack[parser->depth - 1];
+    if (top->container->type == CJ_TYPE_OBJECT) {
+      value->name = parser->name;
+      parser->name = NULL;
+    }
+    parse_frame_append(top, value);
+    parser->state = PARSER_NEXT;
+  }
+  if (value->type == CJ_TYPE_OBJECT || value->type == CJ_TYPE_ARRAY) {
+    if (parser->depth == CJ_MAX_DEPTH) {
+      return false;
+    }
+    if (parser->depth == parser->cap) {
+      parser->cap <<= 1;
+      parser->stack = cj_realloc(parser->stack, parser->cap * sizeof(parse_frame));
+    }
+    parser->stack[parser->depth].container = value;
+    parser->stack[parser->depth].tail = NULL;
+    parser->stack[parser->depth].size = 0;
+    ++parser->depth;
+    parser->state = value->type == CJ_TYPE_OBJECT ? PARSER_OBJECT_FIRST : PARSER_ARRAY_FIRST;
+  }
+  return true;
+}
+
+static bool parser_close(cj_parser *parser, int type) {
+  if (parser->depth == 0 || parser->stack[parser->depth - 1].container->type != type) {
+    return false;
+  }
+  --parser->depth;
+  parse_frame_close(&parser->stack[parser->depth], &parser->ctx);
+  parser->state = parser->depth == 0 ? PARSER_DONE : PARSER_NEXT;
+  return true;
+}
+
+// Decodes the complete string token [p, end).
+static bool parser_emit_string(cj_parser *parser, const char *p, const char *end) {
+  parser->ctx.end = end;
+  cj_string *string = parse_string_raw(&p, &parser->ctx);
+  if (string == NULL || p != end) {
+    cj_free(string);
+    return false;
+  }
+  if (parser->state == PARSER_OBJECT_FIRST || parser->state == PARSER_NAME) {
+    parser->name = string;
+    parser->state = PARSER_COLON;
+    return true;
+  }
+  cj_value *value = create_cj_value(&parser->ctx, CJ_TYPE_STRING);
+  value->value.string = string;
+  parser_add_value(parser, value);
+  return true;
+}
+
+// Decodes the complete number token [p, end); `limit` bounds block reads.
+static bool parser_emit_number(cj_parser *parser, const char *p, const char *end, const char *limit) {
+  bool ok;
+  double number = parse_number_raw(&p, limit, &ok);
+  if (!ok || p != end) {
+    return false;
+  }
+  cj_value *value = create_cj_value(&parser->ctx, CJ_TYPE_NUMBER);
+  value->value.number = number;
+  parser_add_value(parser, value);
+  return true;
+}
+
+// Finds the closing quote of a string whose body starts at p. Returns the
+// position after it, or NULL if the chunk ends first.
+static const char *parser_scan_string(cj_parser *parser, const char *p, const char *end) {
+  while (p < end) {
+    if (parser->escape) {
+      parser->escape = false;
+      ++p;
+      continue;
+    }
+    p += scan_string_run(p, end);
+    if (p == end) {
+      break;
+    }
+    if (*p == '"') {
+      return p + 1;
+    }
+    if (*p == '\\') {
+      parser->escape = true;
+    }
+    ++p; // control characters are rejected by parse_string_raw
+  }
+  return NULL;
+}
+
+static const char *parser_scan_number(const char *p, const char *end) {
+  for (; p < end; ++p) {
+    char c = *p;
+    if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) {
+      break;
+    }
+  }
+  return p;
+}
+
+static void parser_pending_append(cj_parser *parser, const char *p, uint64_t len) {
+  buffer_write_string(&parser->pending, p, len);
+  parser->pending.data[parser->pending.len] = '\0';
+}
+
+// Continues a token cut by the previous chunk. Returns the position after
+// the token, or NULL on error; `p == end` with the token still open means
+// more input is needed.
+static const char *parser_resume_token(cj_parser *parser, const char *p, const char *end) {
+  if (parser->token == TOKEN_STRING) {
+    const char *close = parser_scan_string(parser, p, end);
+    parser_pending_append(parser, p, (close != NULL ? close : end) - p);
+    if (close == NULL) {
+      return end;
+    }
+    parser->token = TOKEN_NONE;
+    buffer *pending = &parser->pending;
+    if (!parser_emit_string(parser, pending->data, pending->data + pending->len)) {
+      return NULL;
+    }
+    return close;
+  } else if (parser->token == TOKEN_NUMBER) {
+    const char *stop = parser_scan_number(p, end);
+    parser_pending_append(parser, p, stop - p);
+    if (stop == end) {
+      return end;
+    }
+    parser->token = TOKEN_NONE;
+    buffer *pending = &parser->pending;
+    if (!parser_emit_number(parser, pending->data, pending->data + pending->len, pending->data + pending->len)) {
+      return NULL;
+    }
+    return stop;
+  } else { // TOKEN_LITERAL
+    for (; p < end && parser->matched < parser->literal_len; ++p, ++parser->matched) {
+      if (*p != parser->literal[parser->matched]) {
+        return NULL;
+      }
+    }
+    if (parser->matched < parser->literal_len) {
+      return end;
+    }
+    parser->token = TOKEN_NONE;
+    parser_add_value(parser, create_cj_value(&parser->ctx, parser->literal_type));
+    return p;
+  }
+}
+
+// Starts the token at p. Complete tokens are decoded straight from the
+// chunk; a token cut by the chunk end is copied to `pending`.
+static const char *parser_start_token(cj_parser *parser, const char *p, const char *end) {
+  char c = *p;
+  if (c == '"') {
+    const char *close = parser_scan_string(parser, p + 1, end);
+    if (close != NULL) {
+      return parser_emit_string(parser, p, close) ? close : NULL;
+    }
+    parser->token = TOKEN_STRING;
+    parser->pending.len = 0;
+    parser_pending_append(parser, p, end - p);
+    return end;
+  } else if ((c >= '0' && c <= '9') || c == '-') {
+    const char *stop = parser_scan_number(p, end);
+    if (stop != end) {
+      return parser_emit_number(parser, p, stop, end) ? stop : NULL;
+    }
+    parser->token = TOKEN_NUMBER;
+    parser->pending.len = 0;
+    parser_pending_append(parser, p, end - p);
+    return end;
+  } else if (c == 't' || c == 'f' || c == 'n') {
+    parser->token = TOKEN_LITERAL;
+    parser->matched = 0;
+    if (c == 't') {
+      parser->literal_type = CJ_TYPE_TRUE;
+      parser->literal = "true";
+      parser->literal_len = 4;
+    } else if (c == 'f') {
+      parser->literal_type = CJ_TYPE_FALSE;
+      parser->literal = "false";
+      parser->literal_len = 5;
+    } else {
+      parser->literal_type = CJ_TYPE_NULL;
+      parser->literal = "null";
+      parser->literal_len = 4;
+    }
+    return parser_resume_token(parser, p, end);
+  } else if (c == '{') {
+    return parser_add_value(parser, create_cj_value(&parser->ctx, CJ_TYPE_OBJECT)) ? p + 1 : NULL;
+  } else if (c == '[') {
+    return parser_add_value(parser, create_cj_value(&parser->ctx, CJ_TYPE_ARRAY)) ? p + 1 : NULL;
+  }
+  return NULL;
+}
+
+bool cj_parser_feed(cj_parser *parser, const char *chunk, uint64_t len) {
+  const char *p = chunk;
+  const char *end = chunk + len;
+  if (parser->state == PARSER_ERROR) {
+    return false;
+  }
+  if (parser->token != TOKEN_NONE) {
+    p = parser_resume_token(parser, p, end);
+    if (p == NULL) {
+      goto label_error;
+    }
+  }
+  while (p < end) {
+    char c = *p;
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      ++p;
+      continue;
+    }
+    int state = parser->state;
+    if (state == PARSER_VALUE || (state == PARSER_ARRAY_FIRST && c != ']')) {
+      p = parser_start_token(parser, p, end);
+    } else if (state == PARSER_ARRAY_FIRST || (state == PARSER_NEXT && c == ']')) {
+      p = parser_close(parser, CJ_TYPE_ARRAY) ? p + 1 : NULL;
+    } else if ((state == PARSER_OBJECT_FIRST || state == PARSER_NEXT) && c == '}') {
+      p = parser_close(parser, CJ_TYPE_OBJECT) ? p + 1 : NULL;
+    } else if ((state == PARSER_OBJECT_FIRST || state == PARSER_NAME) && c == '"') {
+      p = parser_start_token(parser, p, end);
+    } else if (state == PARSER_COLON && c == ':') {
+      parser->state = PARSER_VALUE;
+      ++p;
+    } else if (state == PARSER_NEXT && c == ',') {
+      bool object = parser->stack[parser->depth - 1].container->type == CJ_TYPE_OBJECT;
+      parser->state = object ? PARSER_NAME : PARSER_VALUE;
+      ++p;
+    } else {
+      p = NULL;
+    }
+    if (p == NULL) {
+      goto label_error;
+    }
+  }
+  return true;
+label_error:
+  parser->state = PARSER_ERROR;
+  return false;
+}
+
+cj_value *cj_parser_finish(cj_parser *parser) {
+  cj_value *result = NULL;
+  if (parser->state != PARSER_ERROR && parser->token == TOKEN_NUMBER) {
+    parser->token = TOKEN_NONE;
+    buffer *pending = &parser->pending;
+    const char *end = pending->data + pending->len;
+    if (!parser_emit_number(parser, pending->data, end, end)) {
+      parser->state = PARSER_ERROR;
+    }
+  }
+  if (parser->state == PARSER_DONE && parser->token == TOKEN_NONE) {
+    result = parser->root;
+    parser->root = NULL;
+  }
+  parser_reset(parser);
+  return result;
+}
+
+#define VALUE_STACK_LOCAL 64
+
+// Walks that keep containers on a stack start with VALUE_STACK_LOCAL
+// entries in the caller's frame and only move to the heap past that depth.
+static void value_stack_push(cj_value ***stack, uint64_t *depth, uint64_t *cap, cj_value **local, cj_value *value, const cj_allocator *allocator) {
+  if (*depth == *cap) {
+    if (*stack == local) {
+      *stack = allocator_alloc(allocator, 2 * *cap * sizeof(cj_value *));
+      memcpy(*stack, local, VALUE_STACK_LOCAL * sizeof(cj_value *));
+    } else {
+      *stack = allocator_realloc(allocator, *stack, *cap * sizeof(cj_value *), 2 * *cap * sizeof(cj_value *));
+    }
+    *cap <<= 1;
+  }
+  (*stack)[(*depth)++] = value;
+}
+
+static void value_stack_clean(cj_value **stack, uint64_t cap, cj_value **local, const cj_allocator *allocator) {
+  if (stack != local) {
+    allocator_free(allocator, stack, cap * sizeof(cj_value *));
+  }
+}
+
+void cj_clean(cj_value *value) {
+  cj_clean_with(value, NULL);
+}
+
+// Iterative, in the same order as a recursive walk: a container waits on
+// `stack` while its children are freed, so the stack only grows with nesting.
+void cj_clean_with(cj_value *value, const cj_allocator *allocator) {
+  cj_value *local[VALUE_STACK_LOCAL];
+  cj_value **stack = local;
+  uint64_t depth = 0;
+  uint64_t cap = VALUE_STACK_LOCAL;
+  cj_value *next = NULL;
+  cj_value *p = value;
+  for (;;) {
+    while (p == NULL) {
+      if (depth == 0) {
+        value_stack_clean(stack, cap, local, allocator);
+        return;
+      }
+      p = stack[--depth];
+      next = p->next;
+      allocator_free(allocator, p, value_bytes(p));
+      p = next;
+    }
+    next = p->next;
+    if (p->name != NULL) {
+      allocator_free(allocator, p->name, sizeof(cj_string) + p->name->len + 1);
+    }
+    cj_index *index = value_index(p);
+    if (index != NULL) {
+      allocator_free(allocator, index, index_bytes(index));
+    }
+    if (p->type == CJ_TYPE_OBJECT || p->type == CJ_TYPE_ARRAY) {
+      value_stack_push(&stack, &depth, &cap, local, p, allocator);
+      p = p->value.members;
+      continue;
+    } else if (p->type == CJ_TYPE_STRING) {
+      allocator_free(allocator, p->value.string, sizeof(cj_string) + p->value.string->len + 1);
+    }
+    allocator_free(allocator, p, sizeof(cj_value));
+    p = next;
+  }
+}
+
+// `hash`, if given, is hash_bytes of the key, worked out in advance; it is
+// only needed once the object has an index.
+static cj_value *object_find(cj_value *object, const char *key, uint64_t len, const uint64_t *hash) {
+  if (object == NULL || object->type != CJ_TYPE_OBJECT) {
+    return NULL;
+  }
+  cj_index *index = value_index(object);
+  if (index == NULL) { // never built here: lookups leave the tree as it is
+    cj_value *p = object->value.members;
+    for (; p != NULL; p = p->next) {
+      if (p->name != NULL && name_equals(p->name, key, len)) {
+        return p;
+      }
+    }
+    return NULL;
+  }
+  return index_find(index, key, len, hash != NULL ? *hash : hash_bytes(key, len));
+}
+
+cj_value *cj_object_get(cj_value *object, const char *key, uint64_t len) {
+  return object_find(object, key, len, NULL);
+}
+
+cj_value *cj_object_get_interned(cj_value *object, const cj_string *name) {
+  if (object == NULL || object->type != CJ_TYPE_OBJECT) {
+    return NULL;
+  }
+  cj_index *index = value_index(object);
+  if (index == NULL) {
+    cj_value *p = object->value.members;
+    for (; p != NULL; p = p->next) {
+      if (p->name == name) {
+        return p;
+      }
+    }
+    return NULL;
+  }
+  uint64_t hash = ((const intern_entry *)((const char *)name - offsetof(intern_entry, string)))->hash;
+  uint64_t i = hash & index->mask;
+  for (; index->slots[i].member != NULL; i = (i + 1) & index->mask) {
+    if (index->slots[i].member->name == name) {
+      return index->slots[i].member;
+    }
+  }
+  return NULL;
+}
+
+uint64_t cj_array_size(cj_value *array) {
+  if (array == NULL || array->type != CJ_TYPE_ARRAY) {
+    return 0;
+  }
+  cj_index *index = value_index(array);
+  if (index != NULL) {
+    return index->size;
+  }
+  return count_members(array);
+}
+
+cj_value *cj_array_get(cj_value *array, uint64_t i) {
+  if (array == NULL || array->type != CJ_TYPE_ARRAY) {
+    return NULL;
+  }
+  cj_index *index = value_index(array);
+  if (index != NULL) {
+    return i < index->size ? index->items[i] : NULL;
+  }
+  cj_value *p = array->value.elements;
+  while (p != NULL && i > 0) {
+    p = p->next;
+    --i;
+  }
+  return p;
+}
+
+// Walks the tree like stringify_value, with only the open containers on the
+// stack. Indexes already there, such as those of documents, are kept.
+void cj_index_build_with(cj_value *value, const cj_allocator *allocator) {
+  cj_value *local[VALUE_STACK_LOCAL];
+  cj_value **stack = local;
+  uint64_t depth = 0;
+  uint64_t cap = VALUE_STACK_LOCAL;
+  cj_value *p = value;
+  while (p != NULL) {
+    if ((p->type == CJ_TYPE_OBJECT || p->type == CJ_TYPE_ARRAY) && p->value.members != NULL) {
+      container_node *node = (container_node *)p;
+      // nodes built by hand have no room for an index
+      bool missing = (p->flags & VALUE_CONTAINER) != 0 && node->index == NULL;
+      if (missing && p->type == CJ_TYPE_ARRAY) {
+        node->index = build_array_index(p, count_members(p), NULL, allocator);
+      } else if (missing) {
+        uint64_t size = count_members(p);
+        if (size >= OBJECT_INDEX_MIN_MEMBERS) {
+          node->index = build_object_index(p, size, NULL, allocator);
+        }
+      }
+      value_stack_push(&stack, &depth, &cap, local, p, allocator);
+      p = p->value.members;
+      continue;
+    }
+    while (depth > 0 && p->next == NULL) {
+      p = stack[--depth];
+    }
+    p = depth > 0 ? p->next : NULL;
+  }
+  value_stack_clean(stack, cap, local, allocator);
+}
+
+void cj_index_build(cj_value *value) {
+  cj_index_build_with(value, NULL);
+}
+
+bool cj_has_index(const cj_value *value) {
+  return value != NULL && value_index(value) != NULL;
+}
+
+#define PATH_KEY    1 // a member name or an array index
+#define PATH_ANY    2 // '*': every member or element
+#define PATH_FILTER 3 // '*?name=json': the objects among them whose `name` is json
+
+typedef struct path_segment path_segment;
+
+// `key` is the decoded token, or the member name tested by a filter, and
+// `hash` its hash_bytes. `index` is the token as an array index, UINT64_MAX
+// if it is not one.
+struct path_segment {
+  int type;
+  cj_string key;
+  uint64_t hash;
+  uint64_t index;
+  cj_value *match;
+};
+
+// The decoded keys follow the segments in the same block.
+struct cj_path {
+  uint64_t count;
+  path_segment *segments;
+};
+
+// Decodes the ~0, ~1 and ~2 escapes of a token into `out`. Returns the
+// decoded length, or UINT64_MAX for any other '~'.
+static uint64_t path_unescape(const char *p, const char *end, char *out) {
+  char *start = out;
+  while (p < end) {
+    if (*p != '~') {
+      *out++ = *p++;
+      continue;
+    }
+    ++p; // '~'
+    char c = peek(p, end);
+    if (c == '0') {
+      *out++ = '~';
+    } else if (c == '1') {
+      *out++ = '/';
+    } else if (c == '2') {
+      *out++ = '*';
+    } else {
+      return UINT64_MAX;
+    }
+    ++p; // '0' '1' '2'
+  }
+  return (uint64_t)(out - start);
+}
+
+// Digits without a leading zero, as RFC 6901 requires of array indexes.
+static uint64_t path_index(const cj_string *key) {
+  if (key->len == 0 || key->len > 19 || (key->data[0] == '0' && key->len > 1)) {
+    return UINT64_MAX;
+  }
+  uint64_t index = 0;
+  for (uint64_t i = 0; i < key->len; ++i) {
+    if (key->data[i] < '0' || key->data[i] > '9') {
+      return UINT64_MAX;
+    }
+    index = index * 10 + (key->data[i] - '0');
+  }
+  return index;
+}
+
+static bool path_segment_init(path_segment *segment, const char *p, const char *end, char **keys) {
+  segment->key.data = *keys;
+  segment->index = UINT64_MAX;
+  if (end - p == 1 && *p == '*') {
+    segment->type = PATH_ANY;
+    return true;
+  }
+  segment->type = PATH_KEY;
+  if (end - p >= 2 && p[0] == '*' && p[1] == '?') {
+    segment->type = PATH_FILTER;
+    p += 2; // '*?'
+  }
+  uint64_t len = path_unescape(p, end, *keys);
+  if (len == UINT64_MAX) {
+    return false;
+  }
+  *keys += len;
+  segment->key.len = len;
+  if (segment->type == PATH_FILTER) {
+    char *json = memchr(segment->key.data, '=', len);
+    if (json == NULL) {
+      return false;
+    }
+    segment->key.len = json - segment->key.data;
+    ++json; // '='
+    segment->match = cj_parse_n(json, segment->key.data + len - json, NULL);
+    if (segment->match == NULL || segment->match->type == CJ_TYPE_OBJECT || segment->match->type == CJ_TYPE_ARRAY) {
+      return false;
+    }
+  } else {
+    segment->index = path_index(&segment->key);
+  }
+  segment->hash = hash_bytes(segment->key.data, segment->key.len);
+  return true;
+}
+
+cj_path *cj_path_compile(const char *text) {
+  uint64_t len = strlen(text);
+  if (len > 0 && text[0] != '/') {
+    return NULL;
+  }
+  uint64_t count = 0;
+  for (uint64_t i = 0; i < len; ++i) {
+    count += text[i] == '/';
+  }
+  cj_path *path = cj_malloc(sizeof(cj_path) + count * sizeof(path_segment) + len);
+  path->count = count;
+  path->segments = (path_segment *)(path + 1);
+  memset(path->segments, 0, count * sizeof(path_segment));
+  char *keys = (char *)(path->segments + count);
+  const char *p = text;
+  const char *end = text + len;
+  for (uint64_t i = 0; i < count; ++i) {
+    ++p; // '/'
+    const char *start = p;
+    while (p < end && *p != '/') {
+      ++p;
+    }
+    if (!path_segment_init(&path->segments[i], start, p, &keys)) {
+      cj_path_clean(path);
+      return NULL;
+    }
+  }
+  return path;
+}
+
+void cj_path_clean(cj_path *path) {
+  if (path == NULL) {
+    return;
+  }
+  for (uint64_t i = 0; i < path->count; ++i) {
+    cj_clean(path->segments[i].match);
+  }
+  cj_free(path);
+}
+
+static bool path_filter(const path_segment *segment, cj_value *value) {
+  cj_value *member = object_find(value, segment->key.data, segment->key.len, &segment->hash);
+  if (member == NULL || member->type != segment->match->type) {
+    return false;
+  }
+  if (member->type == CJ_TYPE_STRING) {
+    const cj_string *string = segment->match->value.string;
+    return name_equals(member->value.string, string->data, string->len);
+  }
+  if (member->type == CJ_TYPE_NUMBER) {
+    return member->value.number == segment->match->value.number;
+  }
+  return true;
+}
+
+// Follows the segments from `i` on. Plain keys are a loop; only wildcards
+// and filters recurse, once per segment of the path. Returns false once
+// `visit` has asked to stop.
+static bool path_walk(const cj_path *path, uint64_t i, cj_value *value, cj_visitor visit, void *user, uint64_t *count) {
+  for (; i < path->count; ++i) {
+    const path_segment *segment = &path->segments[i];
+    if (segment->type == PATH_KEY) {
+      if (value->type == CJ_TYPE_ARRAY) {
+        value = segment->index != UINT64_MAX ? cj_array_get(value, segment->index) : NULL;
+      } else {
+        value = object_find(value, segment->key.data, segment->key.len, &segment->hash);
+      }
+      if (value == NULL) {
+        return true;
+      }
+      continue;
+    }
+    if (value->type != CJ_TYPE_OBJECT && value->type != CJ_TYPE_ARRAY) {
+      return true;
+    }
+    cj_value *p = value->value.members;
+    for (; p != NULL; p = p->next) {
+      if (segment->type == PATH_FILTER && !path_filter(segment, p)) {
+        continue;
+      }
+      if (!path_walk(path, i + 1, p, visit, user, count)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  ++*count;
+  return visit == NULL || visit(user, value);
+}
+
+static bool path_first(void *user, cj_value *value) {
+  *(cj_value **)user = value;
+  return false;
+}
+
+cj_value *cj_path_eval(const cj_path *path, cj_value *root) {
+  cj_value *result = NULL;
+  uint64_t count = 0;
+  if (root != NULL) {
+    path_walk(path, 0, root, path_first, &result, &count);
+  }
+  return result;
+}
+
+uint64_t cj_path_each(const cj_path *path, cj_value *root, cj_visitor visit, void *user) {
+  uint64_t count = 0;
+  if (root != NULL) {
+    path_walk(path, 0, root, visit, user, &count);
+  }
+  return count;
+}
+
+// Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers"): digits always read back as the same double and
+// are the shortest such digits for nearly all inputs.
+
+typedef struct diy_fp diy_fp;
+
+struct diy_fp {
+  uint64_t f;
+  int e;
+};
+
+static const uint64_t cached_pow10_f[] = {
+  0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+  0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+  0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+  0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+  0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+  0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+  0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+  0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+  0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+  0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+  0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+  0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+  0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+  0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+  0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+  0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+  0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+  0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+  0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+  0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+  0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+  0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const int16_t cached_pow10_e[] = {
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+  -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+  -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+  -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+  -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+  109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+  375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+  641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+  907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static const uint64_t pow10_u64[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+  100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+  10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+  100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+static const char digit_pairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static diy_fp diy_fp_mul(diy_fp a, diy_fp b) {
+  uint64_t hi, lo;
+  mul_64x64(a.f, b.f, &hi, &lo);
+  diy_fp r = { hi + (lo >> 63), a.e + b.e + 64 };
+  return r;
+}
+
+static diy_fp diy_fp_normalize(diy_fp a) {
+  int s = __builtin_clzll(a.f);
+  diy_fp r = { a.f << s, a.e - s };
+  return r;
+}
+
+static void grisu_round(char *digits, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+  while (
+    rest < wp_w &&
+    delta - rest >= ten_kappa &&
+    (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)
+  ) {
+    --digits[len - 1];
+    rest += ten_kappa;
+  }
+}
+
+static void grisu_digit_gen(diy_fp w, diy_fp mp, uint64_t delta, char *digits, int *len, int *k) {
+  int shift = -mp.e;
+  uint64_t one = 1ULL << shift;
+  uint64_t wp_w = mp.f - w.f;
+  uint32_t p1 = (uint32_t)(mp.f >> shift);
+  uint64_t p2 = mp.f & (one - 1);
+  int kappa = 1;
+  while (kappa < 10 && p1 >= pow10_u64[kappa]) {
+    ++kappa;
+  }
+  *len = 0;
+  while (kappa > 0) {
+    uint32_t d = p1 / (uint32_t)pow10_u64[kappa - 1];
+    p1 %= (uint32_t)pow10_u64[kappa - 1];
+    if (d != 0 || *len != 0) {
+      digits[(*len)++] = '0' + d;
+    }
+    --kappa;
+    uint64_t rest = ((uint64_t)p1 << shift) + p2;
+    if (rest <= delta) {
+      *k += kappa;
+      grisu_round(digits, *len, delta, rest, pow10_u64[kappa] << shift, wp_w);
+      return;
+    }
+  }
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    char d = (char)(p2 >> shift);
+    if (d != 0 || *len != 0) {
+      digits[(*len)++] = '0' + d;
+    }
+    p2 &= one - 1;
+    --kappa;
+    if (p2 < delta) {
+      *k += kappa;
+      grisu_round(digits, *len, delta, p2, one, -kappa < 20 ? wp_w * pow10_u64[-kappa] : 0);
+      return;
+    }
+  }
+}
+
+// Shortest digits of a positive finite double: value = digits * 10^k.
+static int grisu2(double value, char *digits, int *k) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  int biased_e = (int)((bits >> 52) & 0x7FF);
+  diy_fp v;
+  v.f = bits & ((1ULL << 52) - 1);
+  if (biased_e != 0) {
+    v.f += 1ULL << 52;
+    v.e = biased_e - 1075;
+  } else {
+    v.e = -1074;
+  }
+  // boundaries m- and m+, both with the exponent of the normalized m+
+  diy_fp plus = { (v.f << 1) + 1, v.e - 1 };
+  while ((plus.f & (1ULL << 53)) == 0) {
+    plus.f <<= 1;
+    --plus.e;
+  }
+  plus.f <<= 10;
+  plus.e -= 10;
+  diy_fp minus;
+  if (v.f == 1ULL << 52) {
+    minus.f = (v.f << 2) - 1;
+    minus.e = v.e - 2;
+  } else {
+    minus.f = (v.f << 1) - 1;
+    minus.e = v.e - 1;
+  }
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+  // cached power c = 10^-k bringing the exponent into [-60, -32]
+  double dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+  int ik = (int)dk;
+  if (dk - ik > 0.0) {
+    ++ik;
+  }
+  unsigned index = (unsigned)((ik >> 3) + 1);
+  *k = -(-348 + (int)(index << 3));
+  diy_fp c = { cached_pow10_f[index], cached_pow10_e[index] };
+  diy_fp w = diy_fp_mul(diy_fp_normalize(v), c);
+  diy_fp wp = diy_fp_mul(plus, c);
+  diy_fp wm = diy_fp_mul(minus, c);
+  ++wm.f;
+  --wp.f;
+  int len;
+  grisu_digit_gen(w, wp, wp.f - wm.f, digits, &len, k);
+  return len;
+}
+
+static int write_u64(char *out, uint64_t n) {
+  char tmp[20];
+  int i = 20;
+  while (n >= 100) {
+    uint64_t r = n % 100;
+    n /= 100;
+    i -= 2;
+    memcpy(tmp + i, digit_pairs + r * 2, 2);
+  }
+  if (n >= 10) {
+    i -= 2;
+    memcpy(tmp + i, digit_pairs + n * 2, 2);
+  } else {
+    tmp[--i] = '0' + (char)n;
+  }
+  memcpy(out, tmp + i, 20 - i);
+  return 20 - i;
+}
+
+// Formats a finite double the way ECMAScript's Number#toString lays out the
+// shortest digits: plain notation for decimal exponents in (-7, 21], an
+// exponent otherwise. Writes at most 25 bytes.
+static int write_double(char *out, double value) {
+  char *p = out;
+  if (signbit(value)) {
+    *p++ = '-';
+    value = -value;
+  }
+  if (value < 9007199254740992.0 && value == (double)(uint64_t)value) { // integer
+    return (int)(p - out) + write_u64(p, (uint64_t)value);
+  }
+  char digits[24];
+  int k;
+  int len = grisu2(value, digits, &k);
+  int kk = len + k; // 10^(kk-1) <= value < 10^kk
+  if (k >= 0 && kk <= 21) { // 1234e7 -> 12340000000
+    memcpy(p, digits, len);
+    memset(p + len, '0', k);
+    p += kk;
+  } else if (kk > 0 && kk <= 21) { // 1234e-2 -> 12.34
+    memcpy(p, digits, kk);
+    p[kk] = '.';
+    memcpy(p + kk + 1, digits + kk, len - kk);
+    p += len + 1;
+  } else if (kk > -6 && kk <= 0) { // 1234e-6 -> 0.001234
+    p[0] = '0';
+    p[1] = '.';
+    memset(p + 2, '0', -kk);
+    memcpy(p + 2 - kk, digits, len);
+    p += 2 - kk + len;
+  } else { // 1234e30 -> 1.234e+33
+    *p++ = digits[0];
+    if (len > 1) {
+      *p++ = '.';
+      memcpy(p, digits + 1, len - 1);
+      p += len - 1;
+    }
+    *p++ = 'e';
+    int e = kk - 1;
+    if (e < 0) {
+      *p++ = '-';
+      e = -e;
+    } else {
+      *p++ = '+';
+    }
+    p += write_u64(p, (uint64_t)e);
+  }
+  return (int)(p - out);
+}
+
+// Extra output bytes for each input byte of a string: 1 for the short
+// escapes, 5 for the other control characters (\u00XX).
+static const uint8_t escape_extra[256] = {
+  5, 5, 5, 5, 5, 5, 5, 5, 1, 1, 1, 5, 1, 1, 5, 5,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  ['"'] = 1, ['\\'] = 1,
+};
+
+// The letter after '\\' for the bytes with a short escape; 0 for the other
+// control characters, written as \u00XX.
+static const char escape_chars[256] = {
+  ['"'] = '"', ['\\'] = '\\', ['\b'] = 'b', ['\f'] = 'f', ['\n'] = 'n', ['\r'] = 'r', ['\t'] = 't',
+};
+
+// Clean runs are found with scan_string_run, which stops at exactly the
+// bytes JSON requires to be escaped, and copied in one piece.
+static void stringify_string(cj_string *string, buffer *buf) {
+  const char *p = string->data;
+  const char *end = p + string->len;
+  buffer_write_byte(buf, '"');
+  for (;;) {
+    uint64_t run = scan_string_run(p, end);
+    buffer_write_string(buf, p, run);
+    p += run;
+    if (p == end) {
+      break;
+    }
+    uint8_t c = (uint8_t)*p++;
+    if (escape_chars[c] != 0) {
+      char escape[2] = {'\\', escape_chars[c]};
+      buffer_write_string(buf, escape, 2);
+    } else {
+      char escape[6] = {'\\', 'u', '0', '0', hex_chars[c >> 4], hex_chars[c & 0xF]};
+      buffer_write_string(buf, escape, 6);
+    }
+  }
+  buffer_write_byte(buf, '"');
+}
+
+// Iterative like parse_value: `stack` holds the containers being written.
+// Stops early once a writer has failed.
+static void stringify_value(cj_value *value, buffer *buf) {
+  cj_value *local[VALUE_STACK_LOCAL];
+  cj_value **stack = local;
+  uint64_t depth = 0;
+  uint64_t cap = VALUE_STACK_LOCAL;
+  cj_value *p = value;
+label_value:
+  if (p->type == CJ_TYPE_OBJECT || p->type == CJ_TYPE_ARRAY) {
+    buffer_write_byte(buf, p->type == CJ_TYPE_OBJECT ? '{' : '[');
+    if (p->value.members == NULL) {
+      buffer_write_byte(buf, p->type == CJ_TYPE_OBJECT ? '}' : ']');
+      goto label_next;
+    }
+    value_stack_push(&stack, &depth, &cap, local, p, buf->allocator);
+    p = p->value.members;
+    goto label_member;
+  } else if (p->type == CJ_TYPE_STRING) {
+    stringify_string(p->value.string, buf);
+  } else if (p->type == CJ_TYPE_NUMBER) {
+    if (isnan(p->value.number) || isinf(p->value.number)) {
+      buffer_write_string(buf, "null", 4);
+    } else if (buf->writer == NULL || buf->cap - buf->len > 32) {
+      char *out = buffer_reserve(buf, 32);
+      buf->len += write_double(out, p->value.number);
+    } else { // near the end of a fixed block, which may hold no more than it needs
+      char digits[32];
+      buffer_write_string(buf, digits, write_double(digits, p->value.number));
+    }
+  } else if (p->type == CJ_TYPE_TRUE) {
+    buffer_write_string(buf, "true", 4);
+  } else if (p->type == CJ_TYPE_FALSE) {
+    buffer_write_string(buf, "false", 5);
+  } else if (p->type == CJ_TYPE_NULL) {
+    buffer_write_string(buf, "null", 4);
+  }
+label_next:
+  while (depth > 0 && !buf->failed) {
+    if (p->next != NULL) {
+      buffer_write_byte(buf, ',');
+      p = p->next;
+      goto label_member;
+    }
+    p = stack[--depth];
+    buffer_write_byte(buf, p->type == CJ_TYPE_OBJECT ? '}' : ']');
+  }
+  value_stack_clean(stack, cap, local, buf->allocator);
+  return;
+label_member:
+  if (stack[depth - 1]->type == CJ_TYPE_OBJECT) {
+    stringify_string(p->name, buf);
+    buffer_write_byte(buf, ':');
+  }
+  goto label_value;
+}
+
+char *cj_stringify(cj_value *value, uint64_t *len) {
+  return cj_stringify_with(value, len, NULL);
+}
+
+char *cj_stringify_with(cj_value *value, uint64_t *len, const cj_allocator *allocator) {
+  buffer buf;
+  buffer_init(&buf, allocator);
+  stringify_value(value, &buf);
+  buffer_write_byte(&buf, '\0');
+  if (len != NULL) {
+    *len = buf.len - 1;
+  }
+  // handed over as is rather than copied; only the slack is given back
+  return allocator_realloc(allocator, buf.data, buf.cap, buf.len);
+}
+
+static uint64_t measure_string(const cj_string *string) {
+  uint64_t size = string->len + 2;
+  const char *p = string->data;
+  const char *end = p + string->len;
+  for (;;) {
+    p += scan_string_run(p, end);
+    if (p == end) {
+      return size;
+    }
+    size += escape_extra[(uint8_t)*p++];
+  }
+}
+
+// Same walk as stringify_value, adding up lengths instead of writing.
+static uint64_t measure_value(cj_value *value) {
+  cj_value *local[VALUE_STACK_LOCAL];
+  cj_value **stack = local;
+  uint64_t depth = 0;
+  uint64_t cap = VALUE_STACK_LOCAL;
+  uint64_t size = 0;
+  cj_value *p = value;
+label_value:
+  if (p->type == CJ_TYPE_OBJECT || p->type == CJ_TYPE_ARRAY) {
+    size += 2; // '{' '}' or '[' ']'
+    if (p->value.members == NULL) {
+      goto label_next;
+    }
+    value_stack_push(&stack, &depth, &cap, local, p, NULL);
+    p = p->value.members;
+    goto label_member;
+  } else if (p->type == CJ_TYPE_STRING) {
+    size += measure_string(p->value.string);
+  } else if (p->type == CJ_TYPE_NUMBER) {
+    if (isnan(p->value.number) || isinf(p->value.number)) {
+      size += 4;
+    } else {
+      char digits[32];
+      size += write_double(digits, p->value.number);
+    }
+  } else if (p->type == CJ_TYPE_FALSE) {
+    size += 5;
+  } else if (p->type == CJ_TYPE_TRUE || p->type == CJ_TYPE_NULL) {
+    size += 4;
+  }
+label_next:
+  while (depth > 0) {
+    if (p->next != NULL) {
+      ++size; // ','
+      p = p->next;
+      goto label_member;
+    }
+    p = stack[--depth];
+  }
+  value_stack_clean(stack, cap, local, NULL);
+  return size;
+label_member:
+  if (stack[depth - 1]->type == CJ_TYPE_OBJECT) {
+    size += measure_string(p->name) + 1; // ':'
+  }
+  goto label_value;
+}
+
+uint64_t cj_stringify_len(cj_value *value) {
+  return measure_value(value);
+}
+
+static bool stringify_overflow(void *ctx, const cj_chunk *chunks, int count) {
+  (void)ctx;
+  (void)chunks;
+  (void)count;
+  return false;
+}
+
+// `dst` is used as the fixed block of a writer that always fails, so the
+// first time it would be flushed the output is known not to fit. An empty
+// block has nothing to flush and would be written past, so it is turned
+// away first; no output fits in it anyway.
+uint64_t cj_stringify_into(cj_value *value, char *dst, uint64_t cap) {
+  if (cap == 0) {
+    return 0;
+  }
+  buffer buf;
+  buffer_init_writer(&buf, dst, cap, stringify_overflow, NULL);
+  stringify_value(value, &buf);
+  buffer_write_byte(&buf, '\0');
+  return buf.failed ? 0 : buf.len - 1;
+}
+
+#define STRINGIFY_BLOCK (1 << 14)
+
+bool cj_stringify_to(cj_value *value, cj_writer writer, void *ctx) {
+  char block[STRINGIFY_BLOCK];
+  buffer buf;
+  buffer_init_writer(&buf, block, sizeof(block), writer, ctx);
+  stringify_value(value, &buf);
+  buffer_flush(&buf, NULL, 0);
+  return !buf.failed;
+}
+
+bool cj_fd_writer(void *ctx, const cj_chunk *chunks, int count) {
+#if defined(USE_WRITEV)
+  int fd = *(int *)ctx;
+  struct iovec iov[2];
+  struct iovec *v = iov;
+  if (count > 2) {
+    return cj_fd_writer(ctx, chunks, 2) && cj_fd_writer(ctx, chunks + 2, count - 2);
+  }
+  for (int i = 0; i < count; ++i) {
+    iov[i].iov_base = (void *)chunks[i].data;
+    iov[i].iov_len = chunks[i].len;
+  }
+  while (count > 0) {
+    ssize_t written = writev(fd, v, count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    // skip what went out; a partial write resumes mid-chunk
+    while (count > 0 && (size_t)written >= v->iov_len) {
+      written -= v->iov_len;
+      ++v;
+      --count;
+    }
+    if (count > 0) {
+      v->iov_base = (char *)v->iov_base + written;
+      v->iov_len -= written;
+    }
+  }
+  return true;
+#else
+  (void)ctx;
+  (void)chunks;
+  (void)count;
+  return false;
+#endif
+}
+
+#define SCHEMA_SEED_TRIES 64
+#define SCHEMA_MAX_BITS 16
+
+typedef struct schema_field schema_field;
+
+// `name` and `key` are offsets into the schema's `strings`: the name as
+// given, and the `"name":` written before the field when encoding.
+struct schema_field {
+  uint64_t name;
+  uint64_t len;
+  uint64_t key;
+  uint64_t key_len;
+  int type;
+  int element;
+  uint64_t offset;
+  uint64_t element_size;
+  cj_schema *nested;
+};
+
+// Member names are found through a perfect hash: `seed` is chosen at
+// compile time so that every field has a slot of its own, and a lookup is
+// one hash and one comparison.
+struct cj_schema {
+  uint64_t size;
+  uint64_t count;
+  schema_field *fields;
+  uint32_t *slots; // field index + 1, 0 for none
+  uint64_t seed;
+  int shift;
+  buffer strings;
+};
+
+static inline uint64_t schema_slot(const cj_schema *schema, uint64_t hash) {
+  return ((hash ^ schema->seed) * 0x9E3779B97F4A7C15ULL) >> schema->shift;
+}
+
+static uint64_t schema_type_size(int type, uint64_t size) {
+  if (type == CJ_FIELD_BOOL) {
+    return sizeof(bool);
+  } else if (type == CJ_FIELD_INT) {
+    return sizeof(int64_t);
+  } else if (type == CJ_FIELD_DOUBLE) {
+    return sizeof(double);
+  } else if (type == CJ_FIELD_STRING) {
+    return sizeof(cj_string *);
+  } else if (type == CJ_FIELD_OBJECT) {
+    return size;
+  }
+  return sizeof(cj_field_array);
+}
+
+// Tries seeds, then larger tables, until no two names share a slot. Fails
+// on a repeated name.
+static bool schema_build_slots(cj_schema *schema) {
+  bool result = true;
+  uint64_t *hashes = cj_malloc((schema->count + 1) * sizeof(uint64_t));
+  for (uint64_t i = 0; i < schema->count; ++i) {
+    hashes[i] = hash_bytes(schema->strings.data + schema->fields[i].name, schema->fields[i].len);
+  }
+  int bits = 1;
+  while ((1ULL << bits) < schema->count * 2) {
+    ++bits;
+  }
+  for (; bits <= SCHEMA_MAX_BITS; ++bits) {
+    uint64_t cap = 1ULL << bits;
+    schema->slots = cj_realloc(schema->slots, cap * sizeof(uint32_t));
+    schema->shift = 64 - bits;
+    for (uint64_t seed = 0; seed < SCHEMA_SEED_TRIES; ++seed) {
+      schema->seed = seed;
+      memset(schema->slots, 0, cap * sizeof(uint32_t));
+      uint64_t i = 0;
+      for (; i < schema->count; ++i) {
+        uint32_t *slot = &schema->slots[schema_slot(schema, hashes[i])];
+        if (*slot != 0) {
+          const schema_field *other = &schema->fields[*slot - 1];
+          const schema_field *field = &schema->fields[i];
+          if (
+            hashes[*slot - 1] == hashes[i] &&
+            other->len == field->len &&
+            memcmp(schema->strings.data + other->name, schema->strings.data + field->name, field->len) == 0
+          ) {
+            goto label_error;
+          }
+          break;
+        }
+        *slot = (uint32_t)(i + 1);
+      }
+      if (i == schema->count) {
+        goto label_return;
+      }
+    }
+  }
+label_error:
+  result = false;
+label_return:
+  cj_free(hashes);
+  return result;
+}
+
+static cj_schema *schema_compile(const cj_field *fields, uint64_t count, uint64_t size, uint64_t depth) {
+  if (depth == CJ_MAX_DEPTH) {
+    return NULL;
+  }
+  cj_schema *schema = cj_malloc(sizeof(cj_schema) + count * sizeof(schema_field));
+  schema->size = size;
+  schema->count = count;
+  schema->fields = (schema_field *)(schema + 1);
+  schema->slots = NULL;
+  buffer_init(&schema->strings, NULL);
+  memset(schema->fields, 0, count * sizeof(schema_field));
+  for (uint64_t i = 0; i < count; ++i) {
+    const cj_field *from = &fields[i];
+    schema_field *field = &schema->fields[i];
+    field->type = from->type;
+    field->element = from->element;
+    field->offset = from->offset;
+    int type = from->type == CJ_FIELD_ARRAY ? from->element : from->type;
+    if (type < CJ_FIELD_BOOL || type > CJ_FIELD_ARRAY || (from->type == CJ_FIELD_ARRAY && type == CJ_FIELD_ARRAY)) {
+      goto label_error;
+    }
+    if (type == CJ_FIELD_OBJECT) {
+      field->nested = schema_compile(from->fields, from->count, from->size, depth + 1);
+      if (field->nested == NULL) {
+        goto label_error;
+      }
+    }
+    field->element_size = schema_type_size(type, from->size);
+    cj_string name = {strlen(from->name), (char *)from->name};
+    field->name = schema->strings.len;
+    field->len = name.len;
+    buffer_write_string(&schema->strings, name.data, name.len);
+    field->key = schema->strings.len;
+    stringify_string(&name, &schema->strings);
+    buffer_write_byte(&schema->strings, ':');
+    field->key_len = schema->strings.len - field->key;
+  }
+  if (!schema_build_slots(schema)) {
+    goto label_error;
+  }
+  return schema;
+label_error:
+  cj_schema_clean(schema);
+  return NULL;
+}
+
+cj_schema *cj_schema_compile(const cj_field *fields, uint64_t count, uint64_t size) {
+  return schema_compile(fields, count, size, 0);
+}
+
+void cj_schema_clean(cj_schema *schema) {
+  if (schema == NULL) {
+    return;
+  }
+  for (uint64_t i = 0; i < schema->count; ++i) {
+    cj_schema_clean(schema->fields[i].nested);
+  }
+  buffer_clean(&schema->strings);
+  cj_free(schema->slots);
+  cj_free(schema);
+}
+
+static const schema_field *schema_find(const cj_schema *schema, const char *key, uint64_t len) {
+  uint32_t i = schema->slots[schema_slot(schema, hash_bytes(key, len))];
+  if (i == 0) {
+    return NULL;
+  }
+  const schema_field *field = &schema->fields[i - 1];
+  if (field->len != len || memcmp(schema->strings.data + field->name, key, len) != 0) {
+    return NULL;
+  }
+  return field;
+}
+
+static void schema_release(const cj_schema *schema, char *value);
+
+// Releases a field of `type`, the field's own or, for an element, the
+// array's `element`, and zeroes it.
+static void schema_release_value(const schema_field *field, int type, char *value) {
+  if (type == CJ_FIELD_STRING) {
+    cj_free(*(cj_string **)value);
+  } else if (type == CJ_FIELD_OBJECT) {
+    schema_release(field->nested, value);
+  } else if (type == CJ_FIELD_ARRAY) {
+    cj_field_array *array = (cj_field_array *)value;
+    for (uint64_t i = 0; i < array->count; ++i) {
+      schema_release_value(field, field->element, (char *)array->items + i * field->element_size);
+    }
+    cj_free(array->items);
+  }
+  memset(value, 0, type == CJ_FIELD_ARRAY ? sizeof(cj_field_array) : field->element_size);
+}
+
+static void schema_release(const cj_schema *schema, char *value) {
+  for (uint64_t i = 0; i < schema->count; ++i) {
+    const schema_field *field = &schema->fields[i];
+    schema_release_value(field, field->type, value + field->offset);
+  }
+  memset(value, 0, schema->size);
+}
+
+static bool schema_decode_object(const cj_schema *schema, const char **pp, context *ctx, char *out);
+
+// Recursion follows the nesting of the schema, not of the input: members
+// that are not described are skipped without descending into them.
+static bool schema_decode_value(const schema_field *field, int type, const char **pp, context *ctx, char *out) {
+  const char *p = *pp;
+  const char *end = ctx->end;
+  bool result = true;
+  bool ok;
+  if (peek(p, end) == 'n') {
+    result = check_literal(&p, end, "null", 4);
+    goto label_return;
+  }
+  if (type == CJ_FIELD_BOOL) {
+    bool value = peek(p, end) == 't';
+    ok = value ? check_literal(&p, end, "true", 4) : check_literal(&p, end, "false", 5);
+    if (!ok) {
+      goto label_error;
+    }
+    *(bool *)out = value;
+  } else if (type == CJ_FIELD_INT) {
+    double number = parse_number_raw(&p, end, &ok);
+    if (!ok || number != floor(number) || number < -9223372036854775808.0 || number >= 9223372036854775808.0) {
+      goto label_error;
+    }
+    *(int64_t *)out = (int64_t)number;
+  } else if (type == CJ_FIELD_DOUBLE) {
+    double number = parse_number_raw(&p, end, &ok);
+    if (!ok) {
+      goto label_error;
+    }
+    *(double *)out = number;
+  } else if (type == CJ_FIELD_STRING) {
+    if (!decode_string(&p, ctx)) {
+      goto label_error;
+    }
+    buffer *buf = &ctx->scratch;
+    cj_string *string = cj_malloc(sizeof(cj_string) + buf->len + 1);
+    string->len = buf->len;
+    string->data = (char *)(string + 1);
+    memcpy(string->data, buf->data, buf->len);
+    string->data[buf->len] = '\0';
+    *(cj_string **)out = string;
+  } else if (type == CJ_FIELD_OBJECT) {
+    if (!schema_decode_object(field->nested, &p, ctx, out)) {
+      goto label_error;
+    }
+  } else { // CJ_FIELD_ARRAY
+    cj_field_array *array = (cj_field_array *)out;
+    uint64_t cap = 0;
+    if (peek(p, end) != '[') {
+      goto label_error;
+    }
+    ++p; // '['
+    skip_whitespace(&p, end); // ws
+    if (peek(p, end) == ']') {
+      ++p; // ']'
+      goto label_return;
+    }
+    for (;;) {
+      if (array->count == cap) {
+        cap = cap == 0 ? 4 : cap * 2;
+        array->items = cj_realloc(array->items, cap * field->element_size);
+      }
+      char *item = (char *)array->items + array->count * field->element_size;
+      memset(item, 0, field->element_size);
+      ++array->count; // counted first, so a failure below still releases it
+      if (!schema_decode_value(field, field->element, &p, ctx, item)) { // value
+        goto label_error;
+      }
+      skip_whitespace(&p, end); // ws
+      if (peek(p, end) == ']') {
+        break;
+      }
+      if (peek(p, end) != ',') {
+        goto label_error;
+      }
+      ++p; // ','
+      skip_whitespace(&p, end); // ws
+    }
+    ++p; // ']'
+  }
+  goto label_return;
+label_error:
+  result = false;
+label_return:
+  *pp = p;
+  return result;
+}
+
+static bool schema_decode_object(const cj_schema *schema, const char **pp, context *ctx, char *out) {
+  const char *p = *pp;
+  const char *end = ctx->end;
+  bool result = true;
+  if (peek(p, end) != '{') {
+    goto label_error;
+  }
+  ++p; // '{'
+  skip_whitespace(&p, end); // ws
+  if (peek(p, end) == '}') {
+    ++p; // '}'
+    goto label_return;
+  }
+  for (;;) {
+    if (!decode_string(&p, ctx)) { // string
+      goto label_error;
+    }
+    const schema_field *field = schema_find(schema, ctx->scratch.data, ctx->scratch.len);
+    skip_whitespace(&p, end); // ws
+    if (peek(p, end) != ':') {
+      goto label_error;
+    }
+    ++p; // ':'
+    skip_whitespace(&p, end); // ws
+    if (field == NULL) {
+      const char *next = skip_value(p, end); // value
+      if (next == NULL || next == p) {
+        goto label_error;
+      }
+      p = next;
+    } else {
+      char *member = out + field->offset;
+      schema_release_value(field, field->type, member); // a repeated name
+      if (!schema_decode_value(field, field->type, &p, ctx, member)) { // value
+        goto label_error;
+      }
+    }
+    skip_whitespace(&p, end); // ws
+    if (peek(p, end) == '}') {
+      break;
+    }
+    if (peek(p, end) != ',') {
+      goto label_error;
+    }
+    ++p; // ','
+    skip_whitespace(&p, end); // ws
+  }
+  ++p; // '}'
+  goto label_return;
+label_error:
+  result = false;
+label_return:
+  *pp = p;
+  return result;
+}
+
+bool cj_schema_decode(const cj_schema *schema, const char *text, uint64_t len, void *out, char **end) {
+  const char *p = text;
+  context ctx;
+  context_init(&ctx, NULL, NULL);
+  ctx.end = text + len;
+  bool result = true;
+  memset(out, 0, schema->size);
+  skip_whitespace(&p, ctx.end); // ws
+  if (!schema_decode_object(schema, &p, &ctx, out)) { // object
+    goto label_error;
+  }
+  skip_whitespace(&p, ctx.end); // ws
+  if (p != ctx.end) {
+    goto label_error;
+  }
+  goto label_return;
+label_error:
+  schema_release(schema, out);
+  result = false;
+label_return:
+  context_clean(&ctx);
+  if (end != NULL) {
+    *end = (char *)p;
+  }
+  return result;
+}
+
+void cj_schema_release(const cj_schema *schema, void *value) {
+  schema_release(schema, value);
+}
+
+static void schema_encode_object(const cj_schema *schema, const char *in, buffer *buf);
+
+static void schema_encode_value(const schema_field *field, int type, const char *in, buffer *buf) {
+  if (type == CJ_FIELD_BOOL) {
+    if (*(const bool *)in) {
+      buffer_write_string(buf, "true", 4);
+    } else {
+      buffer_write_string(buf, "false", 5);
+    }
+  } else if (type == CJ_FIELD_INT) {
+    int64_t number = *(const int64_t *)in;
+    char *out = buffer_reserve(buf, 21);
+    if (number < 0) {
+      *out++ = '-';
+      ++buf->len;
+    }
+    buf->len += write_u64(out, number < 0 ? -(uint64_t)number : (uint64_t)number);
+  } else if (type == CJ_FIELD_DOUBLE) {
+    double number = *(const double *)in;
+    if (isnan(number) || isinf(number)) {
+      buffer_write_string(buf, "null", 4);
+    } else {
+      char *out = buffer_reserve(buf, 32);
+      buf->len += write_double(out, number);
+    }
+  } else if (type == CJ_FIELD_STRING) {
+    cj_string *string = *(cj_string *const *)in;
+    if (string == NULL) {
+      buffer_write_string(buf, "null", 4);
+    } else {
+      stringify_string(string, buf);
+    }
+  } else if (type == CJ_FIELD_OBJECT) {
+    schema_encode_object(field->nested, in, buf);
+  } else { // CJ_FIELD_ARRAY
+    const cj_field_array *array = (const cj_field_array *)in;
+    buffer_write_byte(buf, '[');
+    for (uint64_t i = 0; i < array->count; ++i) {
+      if (i > 0) {
+        buffer_write_byte(buf, ',');
+      }
+      schema_encode_value(field, field->element, (const char *)array->items + i * field->element_size, buf);
+    }
+    buffer_write_byte(buf, ']');
+  }
+}
+
+static void schema_encode_object(const cj_schema *schema, const char *in, buffer *buf) {
+  buffer_write_byte(buf, '{');
+  for (uint64_t i = 0; i < schema->count; ++i) {
+    const schema_field *field = &schema->fields[i];
+    if (i > 0) {
+      buffer_write_byte(buf, ',');
+    }
+    buffer_write_string(buf, schema->strings.data + field->key, field->key_len);
+    schema_encode_value(field, field->type, in + field->offset, buf);
+  }
+  buffer_write_byte(buf, '}');
+}
+
+char *cj_schema_encode(const cj_schema *schema, const void *value, uint64_t *len) {
+  buffer buf;
+  buffer_init(&buf, NULL);
+  schema_encode_object(schema, value, &buf);
+  buffer_write_byte(&buf, '\0');
+  if (len != NULL) {
+    *len = buf.len - 1;
+  }
+  return cj_realloc(buf.data, buf.len);
+}
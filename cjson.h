@@ -1,12 +1,22 @@
 #ifndef CJSON_H
 #define CJSON_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+// May be defined before this header is included to route the library's
+// memory elsewhere; all three must then be defined.
+#ifndef cj_malloc
 #define cj_malloc(size) malloc(size)
 #define cj_realloc(ptr, size) realloc(ptr, size)
 #define cj_free(ptr) free(ptr)
+#endif
+
+// Deepest nesting of objects and arrays the parsers accept.
+#ifndef CJ_MAX_DEPTH
+#define CJ_MAX_DEPTH 1024
+#endif
 
 #define CJ_TYPE_OBJECT 1
 #define CJ_TYPE_ARRAY  2
@@ -16,16 +26,111 @@
 #define CJ_TYPE_FALSE  6
 #define CJ_TYPE_NULL   7
 
+#define CJ_TAPE_NONE UINT64_MAX
+
+#define CJ_FIELD_BOOL   1 // bool
+#define CJ_FIELD_INT    2 // int64_t
+#define CJ_FIELD_DOUBLE 3 // double
+#define CJ_FIELD_STRING 4 // cj_string *, one block from cj_malloc
+#define CJ_FIELD_OBJECT 5 // a nested struct, itself described by fields
+#define CJ_FIELD_ARRAY  6 // cj_field_array
+
 typedef struct cj_string cj_string;
 typedef struct cj_value cj_value;
+typedef struct cj_index cj_index;
+typedef struct cj_doc cj_doc;
+typedef struct cj_parser cj_parser;
+typedef struct cj_tape cj_tape;
+typedef struct cj_cursor cj_cursor;
+typedef struct cj_sax cj_sax;
+typedef struct cj_chunk cj_chunk;
+typedef struct cj_lines cj_lines;
+typedef struct cj_allocator cj_allocator;
+typedef struct cj_intern cj_intern;
+typedef struct cj_field cj_field;
+typedef struct cj_field_array cj_field_array;
+typedef struct cj_schema cj_schema;
+typedef struct cj_path cj_path;
 
+// `data` is NUL-terminated. Strings allocated by the library keep their
+// bytes right after the struct, in the same block.
 struct cj_string {
   uint64_t len;
-  char data[];
+  char *data;
+};
+
+// A position in raw JSON text, for reading only the parts that are needed.
+// `p` is the start of the value and `name` the start of its member name
+// (NULL outside objects).
+struct cj_cursor {
+  const char *p;
+  const char *end;
+  const char *name;
+};
+
+// Event handlers for cj_sax_parse; any may be NULL. Strings and keys are
+// decoded into a buffer reused for the next one: `data` is NUL-terminated
+// and valid until the handler returns. Returning false stops the parse.
+struct cj_sax {
+  bool (*start_object)(void *user);
+  bool (*end_object)(void *user);
+  bool (*start_array)(void *user);
+  bool (*end_array)(void *user);
+  bool (*key)(void *user, const char *data, uint64_t len);
+  bool (*string)(void *user, const char *data, uint64_t len);
+  bool (*number)(void *user, double number);
+  bool (*boolean)(void *user, bool value);
+  bool (*null)(void *user);
+};
+
+struct cj_chunk {
+  const char *data;
+  uint64_t len;
+};
+
+// Receives serialized output in order, one or two chunks per call.
+// Returning false drops the rest of the output.
+typedef bool (*cj_writer)(void *ctx, const cj_chunk *chunks, int count);
+
+// Receives each match of cj_path_each; returning false stops the search.
+typedef bool (*cj_visitor)(void *user, cj_value *value);
+
+// Memory for the *_with calls, each function being passed `ctx`. `realloc`
+// is also given the size the block had, and `free_sized`, if set, is
+// called instead of `free` with the size the block was allocated with.
+// Neither `realloc` nor the free functions are ever passed NULL.
+struct cj_allocator {
+  void *(*alloc)(void *ctx, uint64_t size);
+  void *(*realloc)(void *ctx, void *ptr, uint64_t old_size, uint64_t size);
+  void (*free)(void *ctx, void *ptr);
+  void (*free_sized)(void *ctx, void *ptr, uint64_t size);
+  void *ctx;
+};
+
+// One member of a struct for cj_schema_compile. `fields`, `count` and
+// `size` describe the nested struct of a CJ_FIELD_OBJECT, or of each
+// element of a CJ_FIELD_ARRAY whose `element` is CJ_FIELD_OBJECT. Arrays of
+// arrays are not supported.
+struct cj_field {
+  const char *name;
+  int type;
+  uint64_t offset;
+  int element;
+  const cj_field *fields;
+  uint64_t count;
+  uint64_t size;
+};
+
+// A CJ_FIELD_ARRAY member: `count` elements of the described type, in one
+// block from cj_malloc.
+struct cj_field_array {
+  void *items;
+  uint64_t count;
 };
 
 struct cj_value {
   int type;
+  int flags; // 0 in nodes built by hand; set by the library
   cj_string *name;
   union {
     cj_value *members;
@@ -38,8 +143,273 @@ struct cj_value {
 
 cj_value *cj_parse(const char *text, char **end);
 
+// Parses exactly `len` bytes; the text need not be NUL-terminated.
+cj_value *cj_parse_n(const char *text, uint64_t len, char **end);
+
+// Parses a file straight from a read-only memory mapping.
+cj_value *cj_parse_file(const char *path);
+
 void cj_clean(cj_value *value);
 
 char *cj_stringify(cj_value *value, uint64_t *len);
 
+// The same as cj_parse_n, cj_clean and cj_stringify, with every allocation
+// (temporary ones included) made from `allocator`; NULL means cj_malloc.
+// A tree must be cleaned with the allocator it was parsed with; it is the
+// same tree cj_parse_n builds. The cj_stringify_with result is len + 1
+// bytes from `allocator`.
+cj_value *cj_parse_with(const char *text, uint64_t len, char **end, const cj_allocator *allocator);
+
+void cj_clean_with(cj_value *value, const cj_allocator *allocator);
+
+char *cj_stringify_with(cj_value *value, uint64_t *len, const cj_allocator *allocator);
+
+// Exact length of the cj_stringify output, without producing it.
+uint64_t cj_stringify_len(cj_value *value);
+
+// Serializes straight into `dst`, NUL-terminated. Returns the length, or 0
+// if `cap` is not at least cj_stringify_len + 1 (dst then holds garbage).
+uint64_t cj_stringify_into(cj_value *value, char *dst, uint64_t cap);
+
+// Serializes through a fixed block on the stack, passing it to `writer`
+// each time it fills up; strings longer than the block follow it as a
+// second chunk. Returns false if the writer failed.
+bool cj_stringify_to(cj_value *value, cj_writer writer, void *ctx);
+
+// cj_writer for the file descriptor at *(int *)ctx, one writev per call.
+bool cj_fd_writer(void *ctx, const cj_chunk *chunks, int count);
+
+// Returns the first member named `key`, or NULL. Objects with an index are
+// searched through it, others member by member. Lookups never change the
+// tree, so any number of threads may search a shared one.
+cj_value *cj_object_get(cj_value *object, const char *key, uint64_t len);
+
+// O(1) on an array with an index, which records the elements in a vector
+// (the `next` links stay valid). Parsing gives one to every array of 32 or
+// more elements; documents and cj_index_build give one to all of them.
+// Without it the elements are counted. Like cj_object_get, these never
+// change the tree.
+uint64_t cj_array_size(cj_value *array);
+
+// O(1) with an element vector, as above; otherwise the first i elements
+// are walked, which is O(i).
+cj_value *cj_array_get(cj_value *array, uint64_t i);
+
+// Gives every non-empty array in the tree an element vector and every
+// object with many members a hash index, from cj_malloc; documents have
+// them from the start. It writes to the tree, so it must be done before the
+// tree is shared between threads, and members must not be added or removed
+// after. cj_clean frees the indexes.
+void cj_index_build(cj_value *value);
+
+// The same, with the indexes from `allocator`; for trees from
+// cj_parse_with, which cj_clean_with then frees along with them.
+void cj_index_build_with(cj_value *value, const cj_allocator *allocator);
+
+// Whether lookups in the object or array go through an index. Only the
+// containers the library allocates have room for one; those built by hand
+// are always searched member by member.
+bool cj_has_index(const cj_value *value);
+
+// Compiles a JSON Pointer (RFC 6901) once, decoding and hashing its tokens,
+// for cj_path_eval and cj_path_each to follow with cj_object_get and
+// cj_array_get semantics. Two kinds of token are added: `*` stands for every
+// member or element, and `*?name=json` for those that are objects whose
+// member `name` equals the scalar `json` (e.g. `*?id="a1"` or `*?n=2`). A
+// token meant literally that is `*` or starts with `*?` writes that '*' as
+// ~2. Returns NULL for a malformed pointer.
+cj_path *cj_path_compile(const char *text);
+
+void cj_path_clean(cj_path *path);
+
+// The first value the path leads to from `root`, or NULL.
+cj_value *cj_path_eval(const cj_path *path, cj_value *root);
+
+// Passes every match to `visit`, in document order, and returns how many
+// were passed.
+uint64_t cj_path_each(const cj_path *path, cj_value *root, cj_visitor visit, void *user);
+
+// Parses into a document that owns every value and string in a few large
+// chunks. Values under cj_doc_root must not be passed to cj_clean; the
+// whole tree is released at once by cj_doc_clean.
+cj_doc *cj_doc_parse(const char *text, char **end);
+
+cj_doc *cj_doc_parse_n(const char *text, uint64_t len, char **end);
+
+cj_doc *cj_doc_parse_file(const char *path);
+
+// Takes the document and its chunks from `allocator`; cj_doc_clean gives
+// them back.
+cj_doc *cj_doc_parse_with(const char *text, uint64_t len, char **end, const cj_allocator *allocator);
+
+// A set of member names. Parsing through one gives every occurrence of a
+// name the same immutable cj_string, which cj_object_get_interned then
+// matches by address. A table may be shared by several documents and must
+// outlive them; it is not safe to use from more than one thread at a time.
+cj_intern *cj_intern_create(void);
+
+void cj_intern_clean(cj_intern *table);
+
+// The interned string for `key`, or NULL if no name like it has been seen.
+const cj_string *cj_intern_find(cj_intern *table, const char *key, uint64_t len);
+
+// Parses like cj_doc_parse_n, interning member names in `table`. With NULL
+// the names are interned for this document alone and kept in its chunks.
+cj_doc *cj_doc_parse_interned(const char *text, uint64_t len, char **end, cj_intern *table);
+
+// cj_object_get for a name from the table the object was parsed with,
+// compared by address only.
+cj_value *cj_object_get_interned(cj_value *object, const cj_string *name);
+
+// A process-wide allocator for the *_with calls that recycles small blocks
+// (values, names and short strings) through size-class free lists. Each
+// thread keeps a bounded cache of its own, so the common path takes no
+// lock; beyond that, blocks move between threads in batches through shared
+// lists. Blocks are carved from slabs a batch at a time. Only `free_sized`
+// is provided. Freed memory stays in the pool until cj_pool_trim gives
+// every slab back to the system, which may only be done when no block is in
+// use and no other thread is using the pool at the time. Threads that used
+// it before may go on afterwards: their caches are dropped, not reused.
+const cj_allocator *cj_pool_allocator(void);
+
+void cj_pool_trim(void);
+
+// Decodes strings and names in place: their `data` points into `text`,
+// which is modified and must outlive the document.
+cj_doc *cj_parse_insitu(char *text, uint64_t len, char **end);
+
+cj_value *cj_doc_root(cj_doc *doc);
+
+void cj_doc_clean(cj_doc *doc);
+
+// Newline-delimited JSON (NDJSON / JSON Lines): every line that is not
+// blank is parsed as a document of its own, a line that is not valid JSON
+// giving NULL. With `threads` above 1 (0 for one per CPU) the text is cut
+// at line boundaries and the pieces are parsed concurrently; the results
+// are the same, in input order. The values belong to the cj_lines, as with
+// a cj_doc, and are released by cj_lines_clean.
+cj_lines *cj_parse_lines(const char *text, uint64_t len, int threads);
+
+cj_lines *cj_parse_lines_file(const char *path, int threads);
+
+uint64_t cj_lines_count(const cj_lines *lines);
+
+cj_value *cj_lines_get(const cj_lines *lines, uint64_t i);
+
+// Byte offset in the text of the line that cj_lines_get(lines, i) came from.
+uint64_t cj_lines_offset(const cj_lines *lines, uint64_t i);
+
+void cj_lines_clean(cj_lines *lines);
+
+// Parses a document whose root is an array on several threads (0 for one
+// per CPU): split points between elements are guessed from the text, the
+// segments are parsed concurrently and their elements joined into one
+// array. When a guess proves wrong, or the root is not a large array, the
+// text is parsed serially instead. Same results as cj_doc_parse_n.
+cj_doc *cj_doc_parse_parallel(const char *text, uint64_t len, int threads, char **end);
+
+// Two-stage parsing: a SIMD pass records the position of every structural
+// character and token start, and a second pass builds the tree from those
+// positions. Same results as cj_parse_n / cj_doc_parse_n.
+cj_value *cj_parse_indexed(const char *text, uint64_t len, char **end);
+
+cj_doc *cj_doc_parse_indexed(const char *text, uint64_t len, char **end);
+
+// The first pass is picked for the CPU at run time: "avx2", "sse4.2" or
+// "scalar". cj_simd_select forces one, returning false if it cannot run here.
+const char *cj_simd_kernel(void);
+
+bool cj_simd_select(const char *name);
+
+// Incremental parsing: feed the text in chunks of any size, then finish to
+// get the same tree cj_parse builds (NULL if the text is not valid JSON).
+// cj_parser_feed returns false as soon as the input is known to be invalid.
+// After finish the parser is ready for the next document.
+cj_parser *cj_parser_create(void);
+
+bool cj_parser_feed(cj_parser *parser, const char *chunk, uint64_t len);
+
+cj_value *cj_parser_finish(cj_parser *parser);
+
+void cj_parser_clean(cj_parser *parser);
+
+// On-demand access: cursors walk the text directly, decoding only what is
+// asked for and skipping everything else by matching brackets and quotes.
+// Only the parts that are read are validated. The text must outlive the
+// cursors. Strings and names are returned on the heap (cj_free them), and
+// cj_cursor_value parses the value into a tree (cj_clean it).
+bool cj_cursor_init(cj_cursor *cur, const char *text, uint64_t len);
+
+int cj_cursor_type(const cj_cursor *cur);
+
+// First element or member of a container; false if it is empty.
+bool cj_cursor_first(const cj_cursor *cur, cj_cursor *child);
+
+// Moves to the next element or member; false after the last one.
+bool cj_cursor_next(cj_cursor *cur);
+
+bool cj_cursor_find(const cj_cursor *object, const char *key, uint64_t len, cj_cursor *member);
+
+bool cj_cursor_at(const cj_cursor *array, uint64_t i, cj_cursor *element);
+
+bool cj_cursor_number(const cj_cursor *cur, double *number);
+
+cj_string *cj_cursor_string(const cj_cursor *cur);
+
+cj_string *cj_cursor_name(const cj_cursor *member);
+
+cj_value *cj_cursor_value(const cj_cursor *cur);
+
+// Streams the document to `sax` without building a tree. Returns false if
+// the text is invalid or a handler stopped it; events already delivered
+// stand.
+bool cj_sax_parse(const char *text, uint64_t len, const cj_sax *sax, void *user, char **end);
+
+// Compact document: every value is one 64-bit word (two for numbers) in a
+// single array in document order, and all strings share one buffer.
+// Values are addressed by position; the root is at 0. The children of a
+// container at `pos` run from pos + 1 up to cj_tape_skip(tape, pos) - 1,
+// each object member being a name (a string position) followed by its value.
+cj_tape *cj_tape_parse(const char *text, uint64_t len, char **end);
+
+void cj_tape_clean(cj_tape *tape);
+
+int cj_tape_type(const cj_tape *tape, uint64_t pos);
+
+// Position of the value after the one at `pos`, skipping its contents.
+uint64_t cj_tape_skip(const cj_tape *tape, uint64_t pos);
+
+// Number of elements or members of the container at `pos`.
+uint64_t cj_tape_size(const cj_tape *tape, uint64_t pos);
+
+const cj_string *cj_tape_string(const cj_tape *tape, uint64_t pos);
+
+double cj_tape_number(const cj_tape *tape, uint64_t pos);
+
+// Position of the value of the first member named `key`, or CJ_TAPE_NONE.
+uint64_t cj_tape_object_get(const cj_tape *tape, uint64_t pos, const char *key, uint64_t len);
+
+// Compiles a description of a struct of `size` bytes into a decoder and
+// encoder for it. Returns NULL if a type is unknown, a name repeats, or
+// nesting goes deeper than CJ_MAX_DEPTH. The names are copied.
+cj_schema *cj_schema_compile(const cj_field *fields, uint64_t count, uint64_t size);
+
+void cj_schema_clean(cj_schema *schema);
+
+// Decodes a JSON object straight into the struct at `out`, without building
+// values: the struct is zeroed, then each member with a described name is
+// written to its field (the last one wins if a name repeats) and the rest
+// are skipped unchecked, as with cj_cursor. null leaves a field zeroed.
+// Numbers for CJ_FIELD_INT must be integers that fit; like all numbers
+// they are read as doubles, so they are exact up to 2^53. On failure the
+// struct is left zeroed.
+bool cj_schema_decode(const cj_schema *schema, const char *text, uint64_t len, void *out, char **end);
+
+// Frees the strings and arrays of a decoded struct and zeroes it.
+void cj_schema_release(const cj_schema *schema, void *value);
+
+// Serializes the struct at `value` as an object with every field, in the
+// order described; a NULL string is written as null.
+char *cj_schema_encode(const cj_schema *schema, const void *value, uint64_t *len);
+
 #endif
@@ -5,12 +5,241 @@
 #include <string.h>
 #include <float.h>
 #include <math.h>
+#include <stddef.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define TEST_THREADS
+#endif
+
+// Records SAX events as a compact trace.
+typedef struct sax_trace sax_trace;
+
+struct sax_trace {
+  char text[256];
+  int len;
+  int limit;
+};
+
+static bool sax_event(sax_trace *trace, const char *event) {
+  trace->len += sprintf(trace->text + trace->len, "%s", event);
+  return trace->limit == 0 || trace->len < trace->limit;
+}
+
+static bool sax_start_object(void *user) {
+  return sax_event(user, "{");
+}
+
+static bool sax_end_object(void *user) {
+  return sax_event(user, "}");
+}
+
+static bool sax_start_array(void *user) {
+  return sax_event(user, "[");
+}
+
+static bool sax_end_array(void *user) {
+  return sax_event(user, "]");
+}
+
+static bool sax_key(void *user, const char *data, uint64_t len) {
+  assert(strlen(data) == len);
+  sax_event(user, "k:");
+  return sax_event(user, data);
+}
+
+static bool sax_string(void *user, const char *data, uint64_t len) {
+  assert(strlen(data) == len);
+  sax_event(user, "s:");
+  return sax_event(user, data);
+}
+
+static bool sax_number(void *user, double number) {
+  char text[32];
+  sprintf(text, "n:%g", number);
+  return sax_event(user, text);
+}
+
+static bool sax_boolean(void *user, bool value) {
+  return sax_event(user, value ? "T" : "F");
+}
+
+static bool sax_null(void *user) {
+  return sax_event(user, "N");
+}
+
+// Collects cj_stringify_to output.
+typedef struct sink sink;
+
+struct sink {
+  char *data;
+  uint64_t len;
+  int calls;
+  int pairs;
+  int fail_after;
+};
+
+static bool sink_write(void *ctx, const cj_chunk *chunks, int count) {
+  sink *out = ctx;
+  ++out->calls;
+  out->pairs += count == 2;
+  for (int i = 0; i < count; ++i) {
+    assert(chunks[i].len > 0);
+    out->data = realloc(out->data, out->len + chunks[i].len);
+    memcpy(out->data + out->len, chunks[i].data, chunks[i].len);
+    out->len += chunks[i].len;
+  }
+  return out->fail_after == 0 || out->calls < out->fail_after;
+}
+
+// Counts the blocks and bytes handed out; sizes given back must match.
+typedef struct counter counter;
+
+struct counter {
+  int64_t blocks;
+  int64_t bytes;
+};
+
+static void *counter_alloc(void *ctx, uint64_t size) {
+  counter *c = ctx;
+  ++c->blocks;
+  c->bytes += size;
+  return malloc(size);
+}
+
+static void *counter_realloc(void *ctx, void *ptr, uint64_t old_size, uint64_t size) {
+  counter *c = ctx;
+  c->bytes += (int64_t)size - (int64_t)old_size;
+  return realloc(ptr, size);
+}
+
+static void counter_free(void *ctx, void *ptr, uint64_t size) {
+  counter *c = ctx;
+  --c->blocks;
+  c->bytes -= size;
+  free(ptr);
+}
+
+// Target structs for the schema decoder.
+typedef struct item item;
+typedef struct order order;
+
+struct item {
+  cj_string *sku;
+  int64_t quantity;
+};
+
+struct order {
+  int64_t id;
+  double total;
+  bool paid;
+  cj_string *note;
+  item first;
+  cj_field_array items;
+  cj_field_array tags;
+};
+
+static const cj_field item_fields[] = {
+  {"sku", CJ_FIELD_STRING, offsetof(item, sku), 0, NULL, 0, 0},
+  {"quantity", CJ_FIELD_INT, offsetof(item, quantity), 0, NULL, 0, 0},
+};
+
+static const cj_field order_fields[] = {
+  {"id", CJ_FIELD_INT, offsetof(order, id), 0, NULL, 0, 0},
+  {"total", CJ_FIELD_DOUBLE, offsetof(order, total), 0, NULL, 0, 0},
+  {"paid", CJ_FIELD_BOOL, offsetof(order, paid), 0, NULL, 0, 0},
+  {"note", CJ_FIELD_STRING, offsetof(order, note), 0, NULL, 0, 0},
+  {"first", CJ_FIELD_OBJECT, offsetof(order, first), 0, item_fields, 2, sizeof(item)},
+  {"items", CJ_FIELD_ARRAY, offsetof(order, items), CJ_FIELD_OBJECT, item_fields, 2, sizeof(item)},
+  {"t\"ags", CJ_FIELD_ARRAY, offsetof(order, tags), CJ_FIELD_STRING, NULL, 0, 0},
+};
+
+// Collects the numbers reached by cj_path_each, stopping after `limit`.
+typedef struct path_matches path_matches;
+
+struct path_matches {
+  double numbers[16];
+  int count;
+  int limit;
+};
+
+static bool path_collect(void *user, cj_value *value) {
+  path_matches *matches = user;
+  matches->numbers[matches->count++] = value->type == CJ_TYPE_NUMBER ? value->value.number : -1;
+  return matches->count != matches->limit;
+}
+
+#if defined(TEST_THREADS)
+#define POOL_TREES 64
+
+// Parses trees through the pool, cleaning half of them and leaving the
+// rest for another thread, so that blocks change threads.
+typedef struct pool_worker pool_worker;
+
+struct pool_worker {
+  const char *text;
+  uint64_t len;
+  const char *expected;
+  cj_value *kept[POOL_TREES / 2];
+  bool ok;
+};
+
+static void *pool_work(void *arg) {
+  pool_worker *w = arg;
+  const cj_allocator *pool = cj_pool_allocator();
+  w->ok = true;
+  for (int i = 0; i < POOL_TREES; ++i) {
+    cj_value *value = cj_parse_with(w->text, w->len, NULL, pool);
+    uint64_t len;
+    char *out = cj_stringify_with(value, &len, pool);
+    w->ok = w->ok && strcmp(out, w->expected) == 0;
+    pool->free_sized(pool->ctx, out, len + 1);
+    if (i % 2 == 0) {
+      cj_clean_with(value, pool);
+    } else {
+      w->kept[i / 2] = value;
+    }
+  }
+  return NULL;
+}
+
+// Fills its cache, waits while the main thread trims the pool, then either
+// parses again or exits with the cache it filled before the trim.
+typedef struct pool_sleeper pool_sleeper;
+
+struct pool_sleeper {
+  const char *text;
+  uint64_t len;
+  pthread_barrier_t *barrier;
+  bool again;
+  bool ok;
+};
+
+static void *pool_sleep(void *arg) {
+  pool_sleeper *s = arg;
+  const cj_allocator *pool = cj_pool_allocator();
+  cj_clean_with(cj_parse_with(s->text, s->len, NULL, pool), pool);
+  pthread_barrier_wait(s->barrier);
+  pthread_barrier_wait(s->barrier); // trimmed in between
+  s->ok = true;
+  if (s->again) {
+    cj_value *value = cj_parse_with(s->text, s->len, NULL, pool);
+    s->ok = value != NULL && cj_array_size(value) == 41;
+    cj_clean_with(value, pool);
+  }
+  return NULL;
+}
+#endif
 
 int main() {
   char *out;
   uint64_t len;
   char *end;
   cj_value *value;
+  cj_doc *doc;
+  cj_parser *parser;
+  cj_tape *tape;
+  uint64_t pos;
 
   // test parse
 
@@ -315,6 +544,48 @@ int main() {
   assert(value != NULL);
   assert(value->value.number == 3.141592653589793238462643383279);
   cj_clean(value);
+
+  value = cj_parse("9007199254740993", &end);
+  assert(value != NULL);
+  assert(value->value.number == 9007199254740992.0);
+  cj_clean(value);
+
+  value = cj_parse("123456789012345678901234567890", &end);
+  assert(value != NULL);
+  assert(value->value.number == 123456789012345678901234567890.0);
+  cj_clean(value);
+
+  value = cj_parse("0.1000000000000000055511151231257827021181583404541015625", &end);
+  assert(value != NULL);
+  assert(value->value.number == 0.1);
+  cj_clean(value);
+
+  value = cj_parse("1.00000000000000011102230246251565404236316680908203125", &end);
+  assert(value != NULL);
+  assert(value->value.number == 1.0);
+  cj_clean(value);
+
+  value = cj_parse("1.00000000000000011102230246251565404236316680908203126", &end);
+  assert(value != NULL);
+  assert(value->value.number == 1.0000000000000002);
+  cj_clean(value);
+
+  value = cj_parse("[1.7976931348623157e308, 2.2250738585072011e-308, 5e-324, 0.3, 1e23]", &end);
+  assert(value != NULL);
+  assert(value->value.elements->value.number == DBL_MAX);
+  assert(value->value.elements->next->value.number == 2.2250738585072011e-308);
+  assert(value->value.elements->next->next->value.number == 4.9406564584124654e-324);
+  assert(value->value.elements->next->next->next->value.number == 0.3);
+  assert(value->value.elements->next->next->next->next->value.number == 1e23);
+  cj_clean(value);
+
+  value = cj_parse("[1e400, -0, 1e-400]", &end);
+  assert(value != NULL);
+  assert(isinf(value->value.elements->value.number));
+  assert(value->value.elements->next->value.number == 0);
+  assert(signbit(value->value.elements->next->value.number));
+  assert(value->value.elements->next->next->value.number == 0);
+  cj_clean(value);
   
   value = cj_parse("true", &end);
   assert(value != NULL);
@@ -438,6 +709,27 @@ int main() {
   assert(value->value.string->len == 420);
   cj_clean(value);
 
+  value = cj_parse("\"abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz\\n0123456789\"", &end);
+  assert(value != NULL);
+  assert(value->value.string->len == 73);
+  assert(value->value.string->data[62] == '\n');
+  cj_clean(value);
+
+  value = cj_parse("\"abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz\x01\"", &end);
+  assert(value == NULL);
+  assert(*end == '\x01');
+  cj_clean(value);
+
+  value = cj_parse("\"abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz\xff\"", &end);
+  assert(value == NULL);
+  assert(*end == '\xff');
+  cj_clean(value);
+
+  value = cj_parse("\"abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz\xe4\xbd\"", &end);
+  assert(value == NULL);
+  assert(*end == '"');
+  cj_clean(value);
+
   // stringify
 
   value = cj_parse("{}", NULL);
@@ -485,12 +777,19 @@ int main() {
   value = cj_parse("{\"name\":1234567890}", NULL);
   out = cj_stringify(value, &len);
   assert(out != NULL);
-  assert(strcmp(out, "{\"name\":1.23457e+09}") == 0);
+  assert(strcmp(out, "{\"name\":1234567890}") == 0);
   cj_clean(value);
   value = cj_parse(out, NULL);
   cj_free(out);
   out = cj_stringify(value, &len);
-  assert(strcmp(out, "{\"name\":1.23457e+09}") == 0);
+  assert(strcmp(out, "{\"name\":1234567890}") == 0);
+  cj_free(out);
+  cj_clean(value);
+
+  value = cj_parse("[0.1,-0,3.141592653589793,1e+30,1e21,123456789012345680000,5e-324,1.7976931348623157e+308,-0.000001,1e-7,123.45,2.5e-40,9007199254740993]", NULL);
+  out = cj_stringify(value, &len);
+  assert(out != NULL);
+  assert(strcmp(out, "[0.1,-0,3.141592653589793,1e+30,1e+21,123456789012345680000,5e-324,1.7976931348623157e+308,-0.000001,1e-7,123.45,2.5e-40,9007199254740992]") == 0);
   cj_free(out);
   cj_clean(value);
 
@@ -578,5 +877,955 @@ int main() {
   cj_free(out);
   cj_clean(value);
 
+  // doc
+
+  doc = cj_doc_parse("{\"name\":\"value\",\"array\":[1,2,{\"key\":null}]}", &end);
+  assert(doc != NULL);
+  value = cj_doc_root(doc);
+  assert(value->type == CJ_TYPE_OBJECT);
+  assert(strcmp(value->value.members->name->data, "name") == 0);
+  assert(strcmp(value->value.members->value.string->data, "value") == 0);
+  assert(value->value.members->next->value.elements->next->next->type == CJ_TYPE_OBJECT);
+  out = cj_stringify(value, &len);
+  assert(strcmp(out, "{\"name\":\"value\",\"array\":[1,2,{\"key\":null}]}") == 0);
+  cj_free(out);
+  cj_doc_clean(doc);
+
+  doc = cj_doc_parse("[1,2,{\"key\":}]", &end);
+  assert(doc == NULL);
+  assert(*end == '}');
+
+  doc = cj_doc_parse(
+"[\"这是一段很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长的字符串\","
+"\"这是一段很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长很长的字符串\"]"
+  , &end);
+  assert(doc != NULL);
+  value = cj_doc_root(doc);
+  assert(value->value.elements->value.string->len == value->value.elements->next->value.string->len);
+  cj_doc_clean(doc);
+
+  // parser
+
+  parser = cj_parser_create();
+  const char *chunked = "{\"name\":\"va\\u4F60lue\",\"array\":[1.5e3,-2,true,false,null,{}],\"\\\"\":[]} ";
+  for (uint64_t i = 0; chunked[i] != '\0'; ++i) {
+    assert(cj_parser_feed(parser, chunked + i, 1));
+  }
+  value = cj_parser_finish(parser);
+  assert(value != NULL);
+  out = cj_stringify(value, &len);
+  assert(strcmp(out, "{\"name\":\"va你lue\",\"array\":[1500,-2,true,false,null,{}],\"\\\"\":[]}") == 0);
+  cj_free(out);
+  cj_clean(value);
+
+  assert(cj_parser_feed(parser, "[12", 3));
+  assert(cj_parser_feed(parser, "34, \"ab", 7));
+  assert(cj_parser_feed(parser, "cd\\", 3));
+  assert(cj_parser_feed(parser, "\"\"]", 3));
+  value = cj_parser_finish(parser);
+  assert(value != NULL);
+  assert(value->value.elements->value.number == 1234);
+  assert(strcmp(value->value.elements->next->value.string->data, "abcd\"") == 0);
+  cj_clean(value);
+
+  assert(cj_parser_feed(parser, "-0.2", 4));
+  assert(cj_parser_feed(parser, "5", 1));
+  value = cj_parser_finish(parser);
+  assert(value != NULL);
+  assert(value->value.number == -0.25);
+  cj_clean(value);
+
+  assert(cj_parser_feed(parser, "[1,", 3));
+  assert(!cj_parser_feed(parser, "]", 1));
+  assert(!cj_parser_feed(parser, "2]", 2));
+  assert(cj_parser_finish(parser) == NULL);
+
+  assert(cj_parser_feed(parser, "[tr", 3));
+  assert(!cj_parser_feed(parser, "ie]", 3));
+  assert(cj_parser_finish(parser) == NULL);
+
+  assert(cj_parser_feed(parser, "{\"a\":nul", 8));
+  assert(cj_parser_finish(parser) == NULL);
+
+  assert(cj_parser_feed(parser, "{} ", 3));
+  assert(!cj_parser_feed(parser, "{}", 2));
+  assert(cj_parser_finish(parser) == NULL);
+  cj_parser_clean(parser);
+
+  // bounded input
+
+  value = cj_parse_n("[1,2]xyz", 5, &end);
+  assert(value != NULL);
+  assert(value->value.elements->next->value.number == 2);
+  cj_clean(value);
+
+  value = cj_parse_n("123456", 3, &end);
+  assert(value != NULL);
+  assert(value->value.number == 123);
+  cj_clean(value);
+
+  value = cj_parse_n("truex", 3, &end);
+  assert(value == NULL);
+  cj_clean(value);
+
+  value = cj_parse_n("\"abcdefghijklmnopqrstuvwxyz0123456789\"", 37, &end);
+  assert(value == NULL);
+  cj_clean(value);
+
+  value = cj_parse_n("\"\\ud83d\\ude0a\"", 15, &end);
+  assert(value == NULL);
+  cj_clean(value);
+
+  value = cj_parse_n("[1] ", 3, &end);
+  assert(value != NULL);
+  assert(*end == ' ');
+  cj_clean(value);
+
+  value = cj_parse_n("[1]\0", 4, &end);
+  assert(value == NULL);
+  cj_clean(value);
+
+  {
+    // more than 19 digits, all zeros, running to the end of the buffer
+    char *zeros = cj_malloc(25);
+    memcpy(zeros, "0.00000000000000000000000", 25);
+    value = cj_parse_n(zeros, 25, &end);
+    assert(value != NULL);
+    assert(value->value.number == 0 && end == zeros + 25);
+    cj_clean(value);
+    cj_free(zeros);
+  }
+
+  value = cj_parse_file("test.json");
+  assert(value != NULL);
+  assert(value->type == CJ_TYPE_OBJECT);
+  cj_clean(value);
+
+  doc = cj_doc_parse_file("test.json");
+  assert(doc != NULL);
+  assert(cj_doc_root(doc)->type == CJ_TYPE_OBJECT);
+  cj_doc_clean(doc);
+
+  assert(cj_parse_file("no-such-file.json") == NULL);
+
+  // object lookup
+
+  value = cj_parse("{\"a\":1,\"b\":2,\"a\":3}", &end);
+  assert(value != NULL);
+  assert(cj_object_get(value, "a", 1)->value.number == 1);
+  assert(cj_object_get(value, "b", 1)->value.number == 2);
+  assert(cj_object_get(value, "c", 1) == NULL);
+  assert(cj_object_get(value, "ab", 1)->value.number == 1);
+  assert(!cj_has_index(value));
+  cj_clean(value);
+
+  {
+    char text[4096];
+    int n = sprintf(text, "{");
+    for (int i = 0; i < 100; ++i) {
+      n += sprintf(text + n, "%s\"key%d\":%d", i > 0 ? "," : "", i, i);
+    }
+    sprintf(text + n, ",\"key7\":-1}");
+
+    value = cj_parse(text, &end);
+    assert(value != NULL);
+    for (int round = 0; round < 2; ++round) {
+      assert(cj_object_get(value, "key99", 5)->value.number == 99);
+      assert(cj_has_index(value) == (round == 1)); // lookups leave it alone
+      for (int i = 0; i < 100; ++i) {
+        char key[16];
+        int key_len = sprintf(key, "key%d", i);
+        assert(cj_object_get(value, key, key_len)->value.number == i);
+      }
+      assert(cj_object_get(value, "key100", 6) == NULL);
+      cj_index_build(value);
+    }
+    cj_clean(value);
+
+    // nested objects, found through arrays and other objects
+    char nested[4200];
+    sprintf(nested, "[1,{\"x\":[%s]},{}]", text);
+    value = cj_parse(nested, &end);
+    assert(value != NULL);
+    cj_value *inner = value->value.elements->next->value.members->value.elements;
+    assert(!cj_has_index(inner));
+    cj_index_build(value);
+    assert(cj_has_index(inner) && !cj_has_index(value->value.elements->next));
+    assert(cj_has_index(value) && cj_array_size(value) == 3);
+    assert(cj_has_index(value->value.elements->next->value.members));
+    assert(cj_object_get(inner, "key42", 5)->value.number == 42);
+    cj_clean(value);
+
+    doc = cj_doc_parse(text, &end);
+    assert(doc != NULL);
+    value = cj_doc_root(doc);
+    assert(cj_has_index(value));
+    assert(cj_object_get(value, "key7", 4)->value.number == 7);
+    assert(cj_object_get(value, "key42", 5)->value.number == 42);
+    assert(cj_object_get(value, "", 0) == NULL);
+    cj_doc_clean(doc);
+  }
+
+  // array access
+
+  value = cj_parse("[]", &end);
+  assert(cj_array_size(value) == 0);
+  assert(cj_array_get(value, 0) == NULL);
+  cj_clean(value);
+
+  value = cj_parse("{\"a\":1}", &end);
+  assert(cj_array_size(value) == 0);
+  cj_clean(value);
+
+  {
+    char text[8192];
+    int n;
+    int sizes[] = {31, 32, 1000}; // long arrays get their vector while parsing
+    for (int s = 0; s < 3; ++s) {
+      n = sprintf(text, "[");
+      for (int i = 0; i < sizes[s]; ++i) {
+        n += sprintf(text + n, "%s%d", i > 0 ? "," : "", i);
+      }
+      n += sprintf(text + n, "]");
+
+      value = cj_parse(text, &end);
+      assert(value != NULL);
+      for (int round = 0; round < 2; ++round) {
+        assert(cj_array_size(value) == (uint64_t)sizes[s]);
+        assert(cj_has_index(value) == (sizes[s] >= 32 || round == 1)); // reads leave it alone
+        for (int i = 0; i < sizes[s]; ++i) {
+          assert(cj_array_get(value, i)->value.number == i);
+        }
+        assert(cj_array_get(value, sizes[s]) == NULL);
+        assert(cj_array_get(value, 10)->next == cj_array_get(value, 11));
+        cj_index_build(value);
+      }
+      cj_clean(value);
+    }
+
+    cj_parser *parser = cj_parser_create();
+    assert(cj_parser_feed(parser, text, n / 2) && cj_parser_feed(parser, text + n / 2, n - n / 2));
+    value = cj_parser_finish(parser);
+    assert(value != NULL && cj_has_index(value));
+    assert(cj_array_get(value, 999)->value.number == 999);
+    cj_clean(value);
+    cj_parser_clean(parser);
+
+    doc = cj_doc_parse(text, &end);
+    assert(doc != NULL);
+    value = cj_doc_root(doc);
+    assert(cj_has_index(value));
+    assert(cj_array_size(value) == 1000);
+    assert(cj_array_get(value, 999)->value.number == 999);
+    cj_doc_clean(doc);
+  }
+
+  // tape
+
+  const char *tape_text = " {\"name\":\"value\",\"array\":[1.5,true,false,null,[],{}],\"n\":-2} ";
+  tape = cj_tape_parse(tape_text, strlen(tape_text), &end);
+  assert(tape != NULL);
+  assert(cj_tape_type(tape, 0) == CJ_TYPE_OBJECT);
+  assert(cj_tape_size(tape, 0) == 3);
+  assert(strcmp(cj_tape_string(tape, 1)->data, "name") == 0);
+  assert(cj_tape_type(tape, 2) == CJ_TYPE_STRING);
+  assert(strcmp(cj_tape_string(tape, 2)->data, "value") == 0);
+  pos = cj_tape_object_get(tape, 0, "array", 5);
+  assert(pos == 4);
+  assert(cj_tape_type(tape, pos) == CJ_TYPE_ARRAY);
+  assert(cj_tape_size(tape, pos) == 6);
+  assert(cj_tape_number(tape, pos + 1) == 1.5);
+  assert(cj_tape_type(tape, cj_tape_skip(tape, pos + 1)) == CJ_TYPE_TRUE);
+  pos = cj_tape_object_get(tape, 0, "n", 1);
+  assert(cj_tape_number(tape, pos) == -2);
+  assert(cj_tape_skip(tape, pos) == cj_tape_skip(tape, 0) - 1);
+  assert(cj_tape_object_get(tape, 0, "missing", 7) == CJ_TAPE_NONE);
+  cj_tape_clean(tape);
+
+  tape = cj_tape_parse("[1,2,", 5, &end);
+  assert(tape == NULL);
+
+  tape = cj_tape_parse("\"abc\"", 5, &end);
+  assert(tape != NULL);
+  assert(cj_tape_string(tape, 0)->len == 3);
+  assert(cj_tape_skip(tape, 0) == 1);
+  cj_tape_clean(tape);
+
+  // indexed
+
+  {
+    const char *kernels[] = {"avx2", "sse4.2", "scalar"};
+    const char *indexed_text = "{\"a\\\\\":[1,-2.5e3,true,false,null],\"b\":\"x\\\"}\\\\\\\\\","
+                               "\"padding to cross the first 64 byte block\":{},\"c\":[[\"\\u4e2d\"],{\"d\":\"]\"}]}";
+    value = cj_parse(indexed_text, &end);
+    char *expected = cj_stringify(value, &len);
+    cj_clean(value);
+    assert(cj_simd_select("scalar"));
+    assert(!cj_simd_select("none"));
+    for (int i = 0; i < 3; ++i) {
+      if (!cj_simd_select(kernels[i])) {
+        continue;
+      }
+      assert(strcmp(cj_simd_kernel(), kernels[i]) == 0);
+      value = cj_parse_indexed(indexed_text, strlen(indexed_text), &end);
+      assert(value != NULL);
+      out = cj_stringify(value, &len);
+      assert(strcmp(out, expected) == 0);
+      cj_free(out);
+      cj_clean(value);
+
+      doc = cj_doc_parse_indexed(indexed_text, strlen(indexed_text), &end);
+      assert(doc != NULL);
+      assert(cj_has_index(cj_object_get(cj_doc_root(doc), "c", 1)));
+      cj_doc_clean(doc);
+
+      value = cj_parse_indexed(" 12 ", 4, &end);
+      assert(value != NULL && value->value.number == 12);
+      cj_clean(value);
+      const char *invalid[] = {"", "[", "[1,]", "{\"a\" 1}", "truex", "1 2", "\"abc", "[1]]", "{\"a\":1,}", "[\x1a]", "\"a\"b"};
+      for (uint64_t j = 0; j < sizeof(invalid) / sizeof(invalid[0]); ++j) {
+        assert(cj_parse_indexed(invalid[j], strlen(invalid[j]), &end) == NULL);
+      }
+    }
+    cj_free(expected);
+  }
+
+  // in-situ
+
+  {
+    char insitu_text[] = "{\"plain\":\"abc\",\"esc\\nname\":\"x\\u00e9\\ty\",\"list\":[\"\",\"\\ud83d\\ude00\"]}";
+    char *insitu_start = insitu_text;
+    doc = cj_parse_insitu(insitu_text, strlen(insitu_text), &end);
+    assert(doc != NULL);
+    value = cj_object_get(cj_doc_root(doc), "plain", 5);
+    assert(value->value.string->len == 3);
+    assert(strcmp(value->value.string->data, "abc") == 0);
+    assert(value->value.string->data > insitu_start && value->value.string->data < insitu_start + sizeof(insitu_text));
+    value = cj_object_get(cj_doc_root(doc), "esc\nname", 8);
+    assert(value != NULL);
+    assert(strcmp(value->value.string->data, "x\xc3\xa9\ty") == 0);
+    assert(value->name->data > insitu_start && value->name->data < insitu_start + sizeof(insitu_text));
+    value = cj_object_get(cj_doc_root(doc), "list", 4);
+    assert(cj_array_get(value, 0)->value.string->len == 0);
+    assert(strcmp(cj_array_get(value, 1)->value.string->data, "\xf0\x9f\x98\x80") == 0);
+    cj_doc_clean(doc);
+
+    char insitu_invalid[] = "[\"abc\\x\"]";
+    assert(cj_parse_insitu(insitu_invalid, strlen(insitu_invalid), &end) == NULL);
+  }
+
+  // cursor
+
+  {
+    const char *cursor_text = " {\"skip\":{\"a\":[1,\"]}\\\"\",{}]},\"n\\u0061me\":\"v\\nw\",\"list\":[10,[2,3],-1.5e2],\"t\":true} ";
+    cj_cursor root;
+    cj_cursor member;
+    cj_cursor element;
+    double number;
+    cj_string *string;
+    assert(cj_cursor_init(&root, cursor_text, strlen(cursor_text)));
+    assert(cj_cursor_type(&root) == CJ_TYPE_OBJECT);
+    assert(cj_cursor_find(&root, "name", 4, &member));
+    assert(cj_cursor_type(&member) == CJ_TYPE_STRING);
+    string = cj_cursor_string(&member);
+    assert(string->len == 3 && strcmp(string->data, "v\nw") == 0);
+    cj_free(string);
+    string = cj_cursor_name(&member);
+    assert(strcmp(string->data, "name") == 0);
+    cj_free(string);
+    assert(cj_cursor_find(&root, "list", 4, &member));
+    assert(cj_cursor_at(&member, 2, &element));
+    assert(cj_cursor_number(&element, &number) && number == -150);
+    assert(!cj_cursor_at(&member, 3, &element));
+    assert(cj_cursor_at(&member, 1, &element));
+    value = cj_cursor_value(&element);
+    out = cj_stringify(value, &len);
+    assert(strcmp(out, "[2,3]") == 0);
+    cj_free(out);
+    cj_clean(value);
+    assert(cj_cursor_find(&root, "t", 1, &member));
+    assert(cj_cursor_type(&member) == CJ_TYPE_TRUE);
+    assert(!cj_cursor_find(&root, "missing", 7, &member));
+
+    int count = 0;
+    if (cj_cursor_first(&root, &member)) {
+      do {
+        ++count;
+      } while (cj_cursor_next(&member));
+    }
+    assert(count == 4);
+
+    assert(cj_cursor_init(&root, "[]", 2));
+    assert(!cj_cursor_first(&root, &element));
+    assert(cj_cursor_init(&root, "12x", 3));
+    assert(!cj_cursor_number(&root, &number));
+    assert(!cj_cursor_init(&root, "  ", 2));
+  }
+
+  // depth
+
+  {
+    uint64_t deep_len = 100000;
+    char *deep = cj_malloc(2 * deep_len + 1);
+    memset(deep, '[', deep_len);
+    memset(deep + deep_len, ']', deep_len);
+    deep[2 * deep_len] = '\0';
+    assert(cj_parse(deep, &end) == NULL);
+    assert(cj_doc_parse(deep, &end) == NULL);
+    assert(cj_parse_indexed(deep, 2 * deep_len, &end) == NULL);
+    assert(cj_tape_parse(deep, 2 * deep_len, &end) == NULL);
+    parser = cj_parser_create();
+    assert(!cj_parser_feed(parser, deep, 2 * deep_len));
+    cj_parser_clean(parser);
+
+    char *limit = deep + deep_len - CJ_MAX_DEPTH;
+    value = cj_parse_n(limit, 2 * CJ_MAX_DEPTH, &end);
+    assert(value != NULL);
+    cj_clean(value);
+    assert(cj_parse_n(limit - 1, 2 * CJ_MAX_DEPTH + 2, &end) == NULL);
+    cj_free(deep);
+
+    // trees built by hand have no depth limit
+    value = NULL;
+    for (uint64_t i = 0; i < deep_len; ++i) {
+      cj_value *array = cj_malloc(sizeof(cj_value));
+      memset(array, 0, sizeof(cj_value));
+      array->type = CJ_TYPE_ARRAY;
+      array->value.elements = value;
+      value = array;
+    }
+    cj_index_build(value); // no room for an index in these
+    assert(!cj_has_index(value) && cj_array_get(value, 0) == value->value.elements);
+    out = cj_stringify(value, &len);
+    assert(len == 2 * deep_len);
+    assert(out[deep_len - 1] == '[' && out[deep_len] == ']');
+    cj_free(out);
+    cj_clean(value);
+  }
+
+  // sax
+
+  {
+    cj_sax sax = {
+      sax_start_object, sax_end_object, sax_start_array, sax_end_array,
+      sax_key, sax_string, sax_number, sax_boolean, sax_null,
+    };
+    sax_trace trace = {"", 0, 0};
+    const char *sax_text = " {\"a\":[1,-2.5,\"x\\ny\"],\"b\":{},\"c\":[true,false,null]} ";
+    assert(cj_sax_parse(sax_text, strlen(sax_text), &sax, &trace, &end));
+    assert(strcmp(trace.text, "{k:a[n:1n:-2.5s:x\ny]k:b{}k:c[TFN]}") == 0);
+    assert(end == sax_text + strlen(sax_text));
+
+    trace.len = 0;
+    trace.limit = 5;
+    assert(!cj_sax_parse(sax_text, strlen(sax_text), &sax, &trace, &end));
+    assert(strcmp(trace.text, "{k:a[") == 0);
+
+    cj_sax quiet = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+    assert(cj_sax_parse(sax_text, strlen(sax_text), &quiet, NULL, &end));
+    assert(!cj_sax_parse("[1,]", 4, &quiet, NULL, &end));
+    assert(*end == ']');
+    assert(!cj_sax_parse("{\"a\":1} x", 9, &quiet, NULL, &end));
+    assert(*end == 'x');
+
+    // both entry points read through the same tokenizer, so they accept the
+    // same texts and stop at the same byte
+    const char *corpus[] = {
+      "0", "-0.5e+3", " \"a\\u00e9\\n\" ", "[]", "{}", "[ ]", "{ }",
+      "[1,[2,[3]],{\"a\":{\"b\":[]}}]", "{\"a\" : 1 , \"b\":[true,false,null]}",
+      "", " ", "[", "]", "{", "[1,]", "[,1]", "[1 2]", "{\"a\"}", "{\"a\":}",
+      "{\"a\":1,}", "{1:2}", "{\"a\" 1}", "[1}", "{\"a\":1]", "tru", "nul",
+      "falsey", "01", "-", "1.", "1e", "\"abc", "\"\\x\"", "[\"a\"\"b\"]", "1 2",
+      "[[[[]]]]]",
+    };
+    for (uint64_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); ++i) {
+      uint64_t len = strlen(corpus[i]);
+      char *tree_end;
+      value = cj_parse_n(corpus[i], len, &tree_end);
+      assert(cj_sax_parse(corpus[i], len, &quiet, NULL, &end) == (value != NULL));
+      assert(end == tree_end);
+      cj_clean(value);
+    }
+    char *deep = cj_malloc(2 * CJ_MAX_DEPTH + 2);
+    for (int extra = 0; extra < 2; ++extra) {
+      uint64_t n = CJ_MAX_DEPTH + extra;
+      memset(deep, '[', n);
+      memset(deep + n, ']', n);
+      char *tree_end;
+      value = cj_parse_n(deep, 2 * n, &tree_end);
+      assert((value != NULL) == (extra == 0));
+      assert(cj_sax_parse(deep, 2 * n, &quiet, NULL, &end) == (value != NULL));
+      assert(end == tree_end);
+      cj_clean(value);
+    }
+    cj_free(deep);
+  }
+
+  // stringify to a writer
+
+  {
+    uint64_t big_len = 100000;
+    char *big = cj_malloc(big_len + 64);
+    int n = sprintf(big, "[\"");
+    for (int i = 0; i < 3000; ++i) {
+      n += sprintf(big + n, "%d,", i);
+    }
+    n += sprintf(big + n, "\",\"");
+    memset(big + n, 'x', 40000);
+    n += 40000;
+    sprintf(big + n, "\",1.5,{\"a\":null}]");
+    value = cj_parse(big, &end);
+    assert(value != NULL);
+    out = cj_stringify(value, &len);
+    assert(strlen(out) == len);
+
+    sink collected = {NULL, 0, 0, 0, 0};
+    assert(cj_stringify_to(value, sink_write, &collected));
+    assert(collected.len == len && memcmp(collected.data, out, len) == 0);
+    assert(collected.calls > 1 && collected.pairs == 1);
+    free(collected.data);
+
+    sink failing = {NULL, 0, 0, 0, 1};
+    assert(!cj_stringify_to(value, sink_write, &failing));
+    assert(failing.calls == 1);
+    free(failing.data);
+
+    FILE *file = tmpfile();
+    int fd = fileno(file);
+    assert(cj_stringify_to(value, cj_fd_writer, &fd));
+    rewind(file);
+    assert(fread(big, 1, big_len + 64, file) == len);
+    assert(memcmp(big, out, len) == 0);
+    fclose(file);
+
+    cj_free(out);
+    cj_free(big);
+    cj_clean(value);
+  }
+
+  // exact-size stringify
+
+  {
+    const char *texts[] = {
+      "[]", "\"\"", "-0.000123", "{\"a\\u0001\\n\":[\"\\\"\\\\/\\t\",1e300,true,false,null,{}]}", "[\"x\",12345678901234567890]",
+    };
+    char into[256];
+    for (uint64_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i) {
+      value = cj_parse(texts[i], &end);
+      assert(value != NULL);
+      out = cj_stringify(value, &len);
+      assert(cj_stringify_len(value) == len);
+      assert(cj_stringify_into(value, into, len + 1) == len);
+      assert(strcmp(into, out) == 0);
+      assert(cj_stringify_into(value, into, len) == 0);
+      assert(cj_stringify_into(value, into, sizeof(into)) == len);
+      uint64_t caps[] = {0, 1, len, len + 1};
+      for (int j = 0; j < 4; ++j) { // in blocks of exactly `cap` bytes
+        char *exact = cj_malloc(caps[j]);
+        assert(cj_stringify_into(value, exact, caps[j]) == (caps[j] == len + 1 ? len : 0));
+        cj_free(exact);
+      }
+      cj_free(out);
+      cj_clean(value);
+    }
+  }
+
+  // lines
+
+  {
+    const char *ndjson = "{\"a\":1}\n\n[true, null]\r\n  \n{\"a\":}\n\"x\\ny\"";
+    cj_lines *lines = cj_parse_lines(ndjson, strlen(ndjson), 1);
+    assert(cj_lines_count(lines) == 4);
+    out = cj_stringify(cj_lines_get(lines, 0), &len);
+    assert(strcmp(out, "{\"a\":1}") == 0);
+    cj_free(out);
+    out = cj_stringify(cj_lines_get(lines, 1), &len);
+    assert(strcmp(out, "[true,null]") == 0);
+    cj_free(out);
+    assert(cj_lines_get(lines, 2) == NULL);
+    assert(cj_lines_offset(lines, 2) == 26);
+    assert(strcmp(cj_lines_get(lines, 3)->value.string->data, "x\ny") == 0);
+    assert(cj_lines_get(lines, 4) == NULL);
+    cj_lines_clean(lines);
+
+    lines = cj_parse_lines("", 0, 4);
+    assert(cj_lines_count(lines) == 0);
+    cj_lines_clean(lines);
+
+    char *big = cj_malloc(1 << 21);
+    uint64_t big_len = 0;
+    for (int i = 0; i < 40000; ++i) {
+      big_len += sprintf(big + big_len, i % 1000 == 999 ? "{\"i\":%d,\n" : "{\"i\":%d,\"s\":\"line\"}\n", i);
+    }
+    cj_lines *serial = cj_parse_lines(big, big_len, 1);
+    lines = cj_parse_lines(big, big_len, 4);
+    assert(cj_lines_count(lines) == 40000);
+    assert(cj_lines_count(serial) == 40000);
+    for (uint64_t i = 0; i < 40000; ++i) {
+      assert(cj_lines_offset(lines, i) == cj_lines_offset(serial, i));
+      value = cj_lines_get(lines, i);
+      if (i % 1000 == 999) {
+        assert(value == NULL && cj_lines_get(serial, i) == NULL);
+      } else {
+        assert(cj_object_get(value, "i", 1)->value.number == (double)i);
+      }
+    }
+    cj_lines_clean(serial);
+    cj_lines_clean(lines);
+    cj_free(big);
+  }
+
+  // parallel root array
+
+  {
+    char *big = cj_malloc(4 << 20);
+    char *serial_out;
+    uint64_t big_len = sprintf(big, "[");
+    for (int i = 0; big_len < (3 << 20); ++i) {
+      big_len += sprintf(big + big_len, "{\"i\":%d,\"s\":\"a\\\"],[{\\\\\",\"t\":[[%d],{}]},\n", i, i);
+    }
+    big[big_len - 2] = ']';
+    cj_doc *serial = cj_doc_parse_n(big, big_len, NULL);
+    doc = cj_doc_parse_parallel(big, big_len, 4, &end);
+    assert(doc != NULL && end == big + big_len);
+    assert(cj_array_size(cj_doc_root(doc)) == cj_array_size(cj_doc_root(serial)));
+    out = cj_stringify(cj_doc_root(doc), &len);
+    serial_out = cj_stringify(cj_doc_root(serial), NULL);
+    assert(strcmp(out, serial_out) == 0);
+    cj_free(out);
+    cj_free(serial_out);
+    cj_doc_clean(serial);
+    cj_doc_clean(doc);
+
+    big[big_len - 100] = '#';
+    doc = cj_doc_parse_parallel(big, big_len, 4, &end);
+    assert(doc == NULL && end == big + big_len - 100);
+
+    // an element larger than the split window: every guess is wrong
+    big_len = sprintf(big, "[[],[\"0\"");
+    for (int j = 0; j < 700000; ++j) {
+      big_len += sprintf(big + big_len, ",\"%d\"", j % 2);
+    }
+    big_len += sprintf(big + big_len, "]]");
+    doc = cj_doc_parse_parallel(big, big_len, 4, &end);
+    assert(doc != NULL && cj_array_size(cj_doc_root(doc)) == 2);
+    assert(cj_array_size(cj_array_get(cj_doc_root(doc), 1)) == 700001);
+    cj_doc_clean(doc);
+    cj_free(big);
+  }
+
+  // allocator
+
+  {
+    counter count = {0, 0};
+    cj_allocator allocator = {counter_alloc, counter_realloc, NULL, counter_free, &count};
+    char text[1024];
+    int text_len = sprintf(text, "{");
+    for (int i = 0; i < 20; ++i) {
+      text_len += sprintf(text + text_len, "\"k%d\":\"v\\u00e9%d\",", i, i);
+    }
+    text_len += sprintf(text + text_len, "\"deep\":%.100s1%.100s}",
+      "[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[",
+      "]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]");
+    value = cj_parse_with(text, text_len, &end, &allocator);
+    assert(value != NULL && count.blocks > 0);
+    int64_t blocks = count.blocks;
+    assert(strcmp(cj_object_get(value, "k19", 3)->value.string->data, "v\xc3\xa9" "19") == 0);
+    assert(cj_array_size(cj_object_get(value, "deep", 4)) == 1);
+    assert(count.blocks == blocks);
+    assert(!cj_has_index(value)); // the same tree cj_parse_n builds
+    cj_index_build_with(value, &allocator);
+    assert(cj_has_index(value) && count.blocks > blocks);
+    assert(strcmp(cj_object_get(value, "k7", 2)->value.string->data, "v\xc3\xa9" "7") == 0);
+    out = cj_stringify_with(value, &len, &allocator);
+    char *expected = cj_stringify(value, NULL);
+    assert(strcmp(out, expected) == 0);
+    cj_free(expected);
+    counter_free(&count, out, len + 1);
+    cj_clean_with(value, &allocator);
+    assert(count.blocks == 0 && count.bytes == 0);
+
+    text[text_len - 20] = '}';
+    assert(cj_parse_with(text, text_len, &end, &allocator) == NULL);
+    assert(count.blocks == 0 && count.bytes == 0);
+
+    doc = cj_doc_parse_with(text, text_len - 20, &end, &allocator);
+    assert(doc == NULL);
+    doc = cj_doc_parse_with("[\"a\",{\"b\":[]}]", 14, &end, &allocator);
+    assert(doc != NULL && count.blocks > 0);
+    assert(cj_array_size(cj_doc_root(doc)) == 2);
+    cj_doc_clean(doc);
+    assert(count.blocks == 0 && count.bytes == 0);
+  }
+
+  // pool
+
+  {
+    const cj_allocator *pool = cj_pool_allocator();
+    char text[2048];
+    int text_len = sprintf(text, "[{\"id\":1,\"tags\":[\"a\",\"b\"],\"long\":\"%0300d\"},", 7);
+    for (int i = 0; i < 40; ++i) {
+      text_len += sprintf(text + text_len, "{\"id\":%d,\"name\":\"n%d\"},", i, i);
+    }
+    text[text_len - 1] = ']';
+    char *expected = NULL;
+    for (int round = 0; round < 3; ++round) {
+      value = cj_parse_with(text, text_len, &end, pool);
+      assert(value != NULL && cj_array_size(value) == 41);
+      out = cj_stringify_with(value, &len, pool);
+      if (expected == NULL) {
+        expected = cj_stringify(value, NULL);
+      }
+      assert(strcmp(out, expected) == 0);
+      pool->free_sized(pool->ctx, out, len + 1);
+      cj_clean_with(value, pool);
+    }
+#if defined(TEST_THREADS)
+    pool_worker workers[4];
+    pthread_t ids[4];
+    for (int round = 0; round < 2; ++round) {
+      for (int i = 0; i < 4; ++i) {
+        workers[i].text = text;
+        workers[i].len = text_len;
+        workers[i].expected = expected;
+        assert(pthread_create(&ids[i], NULL, pool_work, &workers[i]) == 0);
+      }
+      for (int i = 0; i < 4; ++i) {
+        pthread_join(ids[i], NULL);
+        assert(workers[i].ok);
+      }
+      for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < POOL_TREES / 2; ++j) {
+          cj_clean_with(workers[i].kept[j], pool); // on this thread
+        }
+      }
+    }
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, 3);
+    pool_sleeper sleepers[2];
+    for (int i = 0; i < 2; ++i) {
+      sleepers[i] = (pool_sleeper){text, text_len, &barrier, i == 0, false};
+      assert(pthread_create(&ids[i], NULL, pool_sleep, &sleepers[i]) == 0);
+    }
+    pthread_barrier_wait(&barrier);
+    cj_pool_trim();
+    pthread_barrier_wait(&barrier);
+    for (int i = 0; i < 2; ++i) {
+      pthread_join(ids[i], NULL);
+      assert(sleepers[i].ok);
+    }
+    pthread_barrier_destroy(&barrier);
+    for (int round = 0; round < 2; ++round) { // no stale blocks were given back
+      value = cj_parse_with(text, text_len, &end, pool);
+      assert(value != NULL && cj_array_size(value) == 41);
+      cj_clean_with(value, pool);
+    }
+#endif
+    cj_free(expected);
+    cj_pool_trim();
+  }
+
+  // interning
+
+  {
+    const char *text = "[{\"id\":1,\"name\":\"a\"},{\"name\":\"b\",\"id\":2,\"n\\u0061me\":3}]";
+    doc = cj_doc_parse_interned(text, strlen(text), &end, NULL);
+    assert(doc != NULL);
+    cj_value *first = cj_array_get(cj_doc_root(doc), 0);
+    cj_value *second = cj_array_get(cj_doc_root(doc), 1);
+    assert(cj_object_get(first, "name", 4)->name == cj_object_get(second, "name", 4)->name);
+    assert(cj_object_get(first, "id", 2)->name == second->value.members->next->name);
+    out = cj_stringify(cj_doc_root(doc), NULL);
+    assert(strcmp(out, "[{\"id\":1,\"name\":\"a\"},{\"name\":\"b\",\"id\":2,\"name\":3}]") == 0);
+    cj_free(out);
+    cj_doc_clean(doc);
+
+    cj_intern *table = cj_intern_create();
+    assert(cj_intern_find(table, "id", 2) == NULL);
+    char wide[1024];
+    int wide_len = sprintf(wide, "{");
+    for (int i = 0; i < 40; ++i) {
+      wide_len += sprintf(wide + wide_len, "\"k%d\":%d,", i, i);
+    }
+    wide[wide_len - 1] = '}';
+    cj_doc *docs[2];
+    for (int i = 0; i < 2; ++i) {
+      docs[i] = cj_doc_parse_interned(wide, wide_len, &end, table);
+      assert(docs[i] != NULL);
+    }
+    cj_value *a = cj_doc_root(docs[0]);
+    cj_value *b = cj_doc_root(docs[1]);
+    assert(cj_has_index(a));
+    for (int i = 0; i < 40; ++i) {
+      char key[8];
+      int key_len = snprintf(key, sizeof key, "k%d", i);
+      const cj_string *name = cj_intern_find(table, key, key_len);
+      assert(name != NULL && strcmp(name->data, key) == 0);
+      assert(cj_object_get(a, key, key_len)->name == name);
+      assert(cj_object_get(b, key, key_len)->name == name);
+      assert(cj_object_get_interned(a, name)->value.number == i);
+      assert(cj_object_get_interned(b, name)->value.number == i);
+    }
+    assert(cj_intern_find(table, "k40", 3) == NULL);
+    cj_value *small = cj_parse("{\"k1\":1}", &end);
+    assert(cj_object_get_interned(small, cj_intern_find(table, "k1", 2)) == NULL);
+    cj_clean(small);
+    assert(cj_doc_parse_interned("{\"k1\":", 6, &end, table) == NULL);
+    cj_doc_clean(docs[0]);
+    cj_doc_clean(docs[1]);
+    cj_intern_clean(table);
+  }
+
+  // schema
+
+  {
+    cj_schema *schema = cj_schema_compile(order_fields, 7, sizeof(order));
+    assert(schema != NULL);
+    const char *text =
+      "{\"extra\":{\"id\":[1,{}]},\"id\":-42,\"total\":12.5,\"paid\":true,\"note\":\"a\\nb\","
+      "\"first\":{\"quantity\":3,\"sku\":\"x\"},\"items\":[{\"sku\":\"y\",\"quantity\":1},null,{\"quantity\":2e0}],"
+      "\"t\\\"ags\":[\"p\",null],\"note\":\"c\"}";
+    order o;
+    assert(cj_schema_decode(schema, text, strlen(text), &o, &end));
+    assert(o.id == -42 && o.total == 12.5 && o.paid);
+    assert(strcmp(o.note->data, "c") == 0);
+    assert(o.first.quantity == 3 && strcmp(o.first.sku->data, "x") == 0);
+    assert(o.items.count == 3);
+    item *items = o.items.items;
+    assert(strcmp(items[0].sku->data, "y") == 0 && items[0].quantity == 1);
+    assert(items[1].sku == NULL && items[1].quantity == 0);
+    assert(items[2].sku == NULL && items[2].quantity == 2);
+    assert(o.tags.count == 2 && ((cj_string **)o.tags.items)[1] == NULL);
+    out = cj_schema_encode(schema, &o, &len);
+    const char *expected =
+      "{\"id\":-42,\"total\":12.5,\"paid\":true,\"note\":\"c\",\"first\":{\"sku\":\"x\",\"quantity\":3},"
+      "\"items\":[{\"sku\":\"y\",\"quantity\":1},{\"sku\":null,\"quantity\":0},{\"sku\":null,\"quantity\":2}],"
+      "\"t\\\"ags\":[\"p\",null]}";
+    assert(len == strlen(expected) && strcmp(out, expected) == 0);
+    cj_schema_release(schema, &o);
+    assert(o.note == NULL && o.items.items == NULL && o.items.count == 0);
+    assert(cj_schema_decode(schema, out, len, &o, &end) && o.items.count == 3);
+    cj_free(out);
+    cj_schema_release(schema, &o);
+
+    const char *bad[] = {
+      "{\"id\":1.5}",
+      "{\"id\":1e19}",
+      "{\"paid\":1}",
+      "{\"note\":3}",
+      "{\"items\":[{\"sku\":\"y\"},{\"sku\":1}]}",
+      "{\"first\":{\"sku\":\"x\"}",
+      "{\"other\":}",
+      "[]",
+      "{\"id\":1} x",
+    };
+    for (int i = 0; i < (int)(sizeof(bad) / sizeof(bad[0])); ++i) {
+      memset(&o, 0xFF, sizeof(o));
+      assert(!cj_schema_decode(schema, bad[i], strlen(bad[i]), &o, &end));
+      assert(o.note == NULL && o.first.sku == NULL && o.items.items == NULL && o.id == 0);
+    }
+    cj_schema_clean(schema);
+
+    cj_field repeated[] = {
+      {"a", CJ_FIELD_INT, 0, 0, NULL, 0, 0},
+      {"a", CJ_FIELD_INT, 8, 0, NULL, 0, 0},
+    };
+    assert(cj_schema_compile(repeated, 2, 16) == NULL);
+    cj_field nested_arrays[] = {
+      {"a", CJ_FIELD_ARRAY, 0, CJ_FIELD_ARRAY, NULL, 0, 0},
+    };
+    assert(cj_schema_compile(nested_arrays, 1, sizeof(cj_field_array)) == NULL);
+
+    cj_field many[200];
+    char names[200][8];
+    for (int i = 0; i < 200; ++i) {
+      sprintf(names[i], "f%d", i);
+      cj_field field = {names[i], CJ_FIELD_INT, i * sizeof(int64_t), 0, NULL, 0, 0};
+      many[i] = field;
+    }
+    schema = cj_schema_compile(many, 200, sizeof(int64_t) * 200);
+    assert(schema != NULL);
+    int64_t values[200];
+    const char *sparse = "{\"f199\":7,\"f0\":1,\"f200\":2}";
+    assert(cj_schema_decode(schema, sparse, strlen(sparse), values, &end));
+    assert(values[199] == 7 && values[0] == 1 && values[1] == 0);
+    cj_schema_clean(schema);
+  }
+
+  // path
+
+  {
+    const char *text =
+      "{\"orders\":[{\"id\":\"a\",\"items\":[{\"n\":1},{\"n\":2}]},{\"id\":\"b\",\"items\":[{\"n\":3}]},{\"id\":\"a\",\"items\":[]}],"
+      "\"a/b\":1,\"m~n\":2,\"*\":3,\"\":4,\"7\":5}";
+    value = cj_parse(text, &end);
+    assert(value != NULL);
+    cj_path *path = cj_path_compile("");
+    assert(cj_path_eval(path, value) == value);
+    cj_path_clean(path);
+    struct {
+      const char *path;
+      double number;
+    } single[] = {
+      {"/orders/0/items/1/n", 2},
+      {"/orders/1/items/0/n", 3},
+      {"/a~1b", 1},
+      {"/m~0n", 2},
+      {"/~2", 3},
+      {"/", 4},
+      {"/7", 5},
+    };
+    for (int i = 0; i < (int)(sizeof(single) / sizeof(single[0])); ++i) {
+      path = cj_path_compile(single[i].path);
+      assert(path != NULL);
+      cj_value *found = cj_path_eval(path, value);
+      assert(found != NULL && found->type == CJ_TYPE_NUMBER && found->value.number == single[i].number);
+      assert(cj_path_eval(path, value) == found);
+      cj_path_clean(path);
+    }
+    const char *none[] = {"/orders/3", "/orders/-", "/orders/01", "/orders/x", "/orders/0/id/0", "/missing/0"};
+    for (int i = 0; i < (int)(sizeof(none) / sizeof(none[0])); ++i) {
+      path = cj_path_compile(none[i]);
+      assert(path != NULL && cj_path_eval(path, value) == NULL);
+      cj_path_clean(path);
+    }
+    const char *malformed[] = {"orders", "/a~", "/a~3", "/*?id", "/*?id=[1]", "/*?id=x"};
+    for (int i = 0; i < (int)(sizeof(malformed) / sizeof(malformed[0])); ++i) {
+      assert(cj_path_compile(malformed[i]) == NULL);
+    }
+
+    path_matches matches = {{0}, 0, 0};
+    path = cj_path_compile("/orders/*/items/*/n");
+    assert(cj_path_each(path, value, path_collect, &matches) == 3);
+    assert(matches.numbers[0] == 1 && matches.numbers[1] == 2 && matches.numbers[2] == 3);
+    assert(cj_path_eval(path, value)->value.number == 1);
+    matches.count = 0;
+    matches.limit = 2;
+    assert(cj_path_each(path, value, path_collect, &matches) == 2);
+    cj_path_clean(path);
+    path = cj_path_compile("/orders/*?id=\"a\"/items/*/n");
+    assert(cj_path_each(path, value, NULL, NULL) == 2);
+    cj_path_clean(path);
+    path = cj_path_compile("/orders/*?id=\"c\"");
+    assert(cj_path_eval(path, value) == NULL && cj_path_each(path, value, NULL, NULL) == 0);
+    cj_path_clean(path);
+    cj_clean(value);
+
+    char wide[2048];
+    int wide_len = sprintf(wide, "{");
+    for (int i = 0; i < 40; ++i) {
+      wide_len += sprintf(wide + wide_len, "\"k%d\":{\"n\":%d},", i, i);
+    }
+    wide[wide_len - 1] = '}';
+    doc = cj_doc_parse_n(wide, wide_len, &end);
+    path = cj_path_compile("/k37/n");
+    assert(cj_path_eval(path, cj_doc_root(doc))->value.number == 37);
+    cj_path_clean(path);
+    path = cj_path_compile("/*?n=5/n");
+    assert(cj_path_eval(path, cj_doc_root(doc))->value.number == 5);
+    cj_path_clean(path);
+    cj_doc_clean(doc);
+  }
+
   return 0;
 }